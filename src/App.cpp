@@ -6,23 +6,35 @@
 #include <stdexcept>
 
 #include "App.hpp"
-
-App::App(int argc, char **argv) : QApplication(argc, argv) {
+#include "base/DirtyRects.hpp"
+
+App::App(int argc, char **argv, const Options &options)
+        : QApplication(argc, argv),
+          m_resolutionController(
+                  options.getFloat("target-frame-time", 0.0f) / 1000.0f,
+                  options.getFloat("min-scale", 0.25f),
+                  options.getFloat("max-scale", 1.0f)
+          ) {
     auto fontId = QFontDatabase::addApplicationFont("res/font/Roboto-Regular.ttf");
     auto fontFamily = QFontDatabase::applicationFontFamilies(fontId).at(0);
     auto font = QFont(fontFamily, 10);
 
     setFont(font);
 
-    m_sceneModel = new SceneModel();
-    m_fpsModel = new FPSModel(60.0f);
+    m_sceneModel = new SceneModel(options);
+    m_frameScheduler = new FrameScheduler(options.getFloat("fps", 60.0f));
 
-    auto objectBasePath = QString(argv[1]);
-    auto objectPaths = QDir(objectBasePath).entryList(QStringList() << "*.ply", QDir::Files);
+    m_objectBasePath = QString::fromStdString(options.getArguments().at(0));
+    auto objectPaths = QDir(m_objectBasePath).entryList(QStringList() << "*.ply", QDir::Files);
 
     m_statusView = new StatusView();
+    m_statusView->setGovernorPolicy(m_sceneModel->getGovernor().getPolicy());
+    m_statusView->setAnimating(m_sceneModel->isAnimating());
+    m_statusView->setProgressive(m_sceneModel->isProgressive());
     m_objectsView = new ObjectsView(objectPaths);
+    m_objectsView->setBuildProfile(m_sceneModel->getBuildProfile());
     m_pixelsView = new PixelsView();
+    m_pixelsView->setPixelFormat(m_sceneModel->getPixelFormat());
 
     //m_pixelsView->setFixedSize(600, 600);
 
@@ -33,38 +45,116 @@ App::App(int argc, char **argv) : QApplication(argc, argv) {
             nullptr
     );
 
-    connect(m_fpsModel, &FPSModel::updated, [=](float fps) {
-        if (m_allowRender) {
-            m_sceneModel->setSize(m_pixelsView->getTextureSize());
-            m_sceneModel->render();
+    m_renderThread = new RenderThread(*m_sceneModel);
+
+    // Frames are traced on the render thread. Here, only show the latest finished one.
+    // Nothing is repainted while no new frames come. (e.g. Animation is off)
+    connect(m_frameScheduler, &FrameScheduler::ticked, [=]() {
+        auto frame = m_renderThread->fetchFrame();
 
-            m_pixelsView->setPixels(m_sceneModel->getPixels().data());
+        if (frame != nullptr) {
+            m_frame = frame;
+
+            // Progressive frames get faster as they converge, so they don't show what a frame costs.
+            if (frame->size == m_resolutionController.getSize(m_pixelsView->getViewSize())
+                && !m_sceneModel->isProgressive()) {
+                m_resolutionController.update(frame->workTime);
+            }
 
             m_statusView->updateFrameLabel();
-            m_statusView->updateFPSLabel(fps);
-            m_statusView->updateRPSLabel(m_sceneModel->getRPS());
+            m_statusView->updateRPSLabel(frame->rps);
+            m_statusView->updateRayStatsLabel(frame->rayStats);
+            m_statusView->updateHeadroomLabel(frame->headroom);
+            m_statusView->updateSizeLabel(frame->size);
+            m_statusView->updateResolutionLabel(frame->size, m_resolutionController.getScale());
+            m_statusView->updateSamplesLabel(frame->sampleCount, frame->convergence);
+        }
+
+        // Also retries the last frame if the view couldn't take it, or lost its texture since.
+        if (m_frame != nullptr && m_pixelsView->getUploadedFrame() != m_frame->index) {
+            // The texture follows the frames, and is stretched over the view.
+            m_pixelsView->setTextureSize(m_frame->size);
+
+            auto rects = getDirtyRects(
+                    m_frame->size, m_frame->tileSize, m_frame->tileFrames, m_pixelsView->getUploadedFrame()
+            );
+
+            // Identical frames aren't uploaded, nor repainted.
+            if (m_pixelsView->setPixels(m_frame->pixels.data(), rects, m_frame->index)) {
+                m_pixelsView->update();
+            }
+        }
+
+        std::string error;
+
+        // A failed frame leaves the last one on screen, so say why nothing changes.
+        if (m_renderThread->fetchError(error)) {
+            m_statusView->updateErrorLabel(QString::fromStdString(error));
         }
 
-        m_statusView->updateSizeLabel(m_sceneModel->getSize());
-        m_pixelsView->update();
+        m_renderThread->setSize(m_resolutionController.getSize(m_pixelsView->getViewSize()));
+
+        m_statusView->updateFPSLabel(m_frameScheduler->getFPS());
+        m_statusView->updateFrameTimeLabel(
+                m_frameScheduler->getFrameTimePercentile(0.5f),
+                m_frameScheduler->getFrameTimePercentile(0.95f),
+                m_frameScheduler->getFrameTimePercentile(0.99f)
+        );
+        m_statusView->updateMemoryLabel(m_sceneModel->getMemoryUsage(), m_sceneModel->getMemoryBudget());
+        m_objectsView->updateLoadingLabel(m_sceneModel->isLoading(), m_sceneModel->getLoadProgress());
+        m_objectsView->updateBuildLabel(m_sceneModel->getBuildStats());
+    });
+
+    connect(m_pixelsView, &QOpenGLWidget::frameSwapped, m_frameScheduler, &FrameScheduler::presented);
+
+    connect(m_statusView, &StatusView::animateRequested, [=](bool animating) {
+        m_sceneModel->setAnimating(animating);
+        m_renderThread->wake();
+    });
+
+    connect(m_statusView, &StatusView::progressiveRequested, [=](bool progressive) {
+        m_sceneModel->setProgressive(progressive);
+        m_renderThread->wake();
+    });
+
+    connect(m_statusView, &StatusView::governorRequested, [=](FrameGovernor::Policy policy) {
+        m_sceneModel->getGovernor().setPolicy(policy);
     });
 
     connect(m_objectsView, &ObjectsView::requested, [=](const QString &path) {
-        QtConcurrent::run([=]() {
-            try {
-                m_objectsView->disableButtons();
-
-                m_allowRender = false;
-                auto objectPath = QString("%1/%2").arg(objectBasePath).arg(path).toStdString();
-                m_sceneModel->setMainObject(objectPath);
-                m_allowRender = true;
-
-                m_objectsView->enableButtons();
-            } catch (std::exception &error) {
-                std::cout << error.what() << "\n";
-                //std::cin.get();
-            }
-        });
+        loadObject(path);
+    });
+
+    // Rebuild the current model, so the profiles can be compared.
+    connect(m_objectsView, &ObjectsView::buildProfileRequested, [=](BuildProfile profile) {
+        m_sceneModel->setBuildProfile(profile);
+
+        if (!m_objectPath.isEmpty()) {
+            loadObject(m_objectPath);
+        }
+    });
+}
+
+App::~App() {
+    // Stop tracing before the scene goes away.
+    delete m_renderThread;
+}
+
+void App::loadObject(const QString &path) {
+    m_objectPath = path;
+
+    auto objectPath = QString("%1/%2").arg(m_objectBasePath).arg(path).toStdString();
+    auto sceneModel = m_sceneModel;
+
+    // The scene is built off-thread while the previous model keeps rendering.
+    // Another click cancels this build, so the buttons stay enabled.
+    QtConcurrent::run([=]() {
+        try {
+            sceneModel->setMainObject(objectPath);
+        } catch (std::exception &error) {
+            std::cout << error.what() << "\n";
+            //std::cin.get();
+        }
     });
 }
 
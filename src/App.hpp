@@ -2,8 +2,12 @@
 
 #include <QApplication>
 
+#include "base/Options.hpp"
+#include "base/ResolutionController.hpp"
+
 #include "model/SceneModel.hpp"
-#include "model/FPSModel.hpp"
+#include "model/FrameScheduler.hpp"
+#include "model/RenderThread.hpp"
 
 #include "view/StatusView.hpp"
 #include "view/ObjectsView.hpp"
@@ -12,18 +16,27 @@
 
 class App : public QApplication {
 public:
-    App(int argc, char *argv[]);
+    App(int argc, char *argv[], const Options &options);
+    ~App() override;
 
     bool notify(QObject *receiver, QEvent *event) override;
 
 private:
+    void loadObject(const QString &path);
+
     SceneModel *m_sceneModel;
-    FPSModel *m_fpsModel;
+    FrameScheduler *m_frameScheduler;
+    RenderThread *m_renderThread;
+    ResolutionController m_resolutionController;
 
     StatusView *m_statusView;
     ObjectsView *m_objectsView;
     PixelsView *m_pixelsView;
     WindowView *m_windowView;
 
-    bool m_allowRender = true;
+    QString m_objectBasePath;
+    QString m_objectPath;
+
+    // Latest frame fetched from the render thread. Kept until it's uploaded, since the view may not take it at once.
+    const RenderThread::Frame *m_frame = nullptr;
 };
@@ -0,0 +1,212 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <xmmintrin.h>
+#include <pmmintrin.h>
+
+#include "base/Options.hpp"
+#include "base/Image.hpp"
+#include "model/SceneModel.hpp"
+
+// Renders the same frames with each tile schedule, and reports the fastest.
+static void tune(SceneModel &sceneModel, int frameCount, const std::string &outputPath) {
+    // A still view, so every schedule traces the same rays.
+    sceneModel.setAnimating(false);
+    sceneModel.setProgressive(false);
+
+    std::vector<TileSchedule> schedules;
+
+    // Zero: the size picked from the frame size and the threads. (--tile-size=auto)
+    for (auto tileSize : {0, 4, 8, 16, 32}) {
+        for (auto order : getTileOrders()) {
+            for (auto partitioner : getTilePartitioners()) {
+                // Every partitioner splits the tiles down to at most the grain size.
+                for (auto grainSize : {1, 2, 4, 8}) {
+                    TileSchedule schedule;
+
+                    schedule.tileSize = tileSize;
+                    schedule.order = order;
+                    schedule.partitioner = partitioner;
+                    schedule.grainSize = grainSize;
+                    schedules.push_back(schedule);
+                }
+            }
+        }
+    }
+
+    std::ofstream results(outputPath + "/tuning.csv");
+
+    if (results.fail()) {
+        throw std::runtime_error("Failed to open " + outputPath + "/tuning.csv");
+    }
+
+    results << "tile_size,tile_order,partitioner,grain_size,milliseconds,mrays_per_second\n";
+
+    std::cout << "Tuning " << schedules.size() << " tile schedules, " << frameCount << " frames each\n";
+
+    auto bestSchedule = schedules.front();
+    auto bestTime = std::numeric_limits<double>::infinity();
+
+    for (auto &schedule : schedules) {
+        sceneModel.setTileSchedule(schedule);
+
+        // Warm-up: the first frame of a schedule lays out the tiles (and trains the affinity partitioner).
+        sceneModel.render();
+
+        double time = 0.0;
+        long long rayCount = 0;
+
+        for (int frame = 0; frame < frameCount; frame++) {
+            sceneModel.render();
+            time += sceneModel.getGovernor().getWorkTime();
+            rayCount += sceneModel.getRayStats().getRayCount();
+        }
+
+        auto milliseconds = time / frameCount * 1000.0;
+        auto mrays = static_cast<double>(rayCount) / time / 1000000.0;
+
+        std::cout << getTileScheduleOptions(schedule) << ": " << milliseconds << " ms, " << mrays << " Mrays/s\n";
+
+        results << ((schedule.tileSize > 0) ? std::to_string(schedule.tileSize) : "auto") << ","
+                << getTileOrderName(schedule.order) << ","
+                << getTilePartitionerName(schedule.partitioner) << ","
+                << schedule.grainSize << ","
+                << milliseconds << ","
+                << mrays << "\n";
+
+        if (time < bestTime) {
+            bestTime = time;
+            bestSchedule = schedule;
+        }
+    }
+
+    std::cout << "Fastest: " << getTileScheduleOptions(bestSchedule) << "\n";
+}
+
+int main(int argc, char *argv[]) try {
+    Options options(argc, argv);
+
+    if (options.getArguments().empty()) {
+        std::cout << "Usage: " << argv[0] << " (Model's path) [Options]\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --width=(Pixels, default: 600)\n"
+                  << "  --height=(Pixels, default: 500)\n"
+                  << "  --frames=(Count, default: 100)\n"
+                  << "  --output=(Directory, default: .)\n"
+                  << "  --save-images=(1|0, default: 1)\n"
+                  << "  --governor=(uncapped|target-fps|target-mrays|power-save)\n"
+                  << "  --governor-target=(FPS or Mrays/s)\n"
+                  << "  --mesh-cache=(directory, empty to disable, default: user cache directory)\n"
+                  << "  --mesh-cache-size=(MB, 0 for no limit, default: 4096)\n"
+                  << "  --build=(fast-load|balanced|high-quality, default: balanced)\n"
+                  << "  --memory-budget=(MB, default: 0 = unlimited)\n"
+                  << "  --threads=(Embree threads) --isa=(sse4.2|avx|avx2|avx512) --set-affinity\n"
+                  << "  --frequency-level=(simd128|simd256|simd512)\n"
+                  << "  --render-threads=(count) --pin-cpus=(e.g. 0-3,8)\n"
+                  << "  --animate=(1|0, default: 1) --animate-lights=(1|0, default: 1, 0 with --reproject=1)\n"
+                  << "  --pixel-format=(rgba32f|rgba16f|rgb10a2|rgba8-srgb, default: rgba32f)\n"
+                  << "  --progressive=(1|0, default: 0) --max-samples=(count, default: 256)\n"
+                  << "  --convergence=(error of a tile to stop sampling it at, default: 0.001)\n"
+                  << "  --reproject=(1|0, default: 0) --reproject-age=(frames, default: 4)\n"
+                  << "  --tile-size=(multiple of 4|auto, default: 8) --tile-order=(row-major|morton|hilbert)\n"
+                  << "  --partitioner=(auto|affinity|static|simple) --grain-size=(tiles, default: 1)\n"
+                  << "  --tune=(1|0, default: 0: render --frames frames with each tile schedule, report the fastest)\n"
+                  << "  --config=(file of name=value lines, overridden by the command line)\n";
+        return 0;
+    }
+
+    // From Embree document Chapter 8.
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+
+    auto size = glm::ivec2(options.getInt("width", 600), options.getInt("height", 500));
+    auto frameCount = options.getInt("frames", 100);
+    auto outputPath = options.getString("output", ".");
+    auto saveImages = options.getBool("save-images", true);
+
+    if (size.x <= 0 || size.y <= 0 || frameCount <= 0) {
+        throw std::runtime_error("Size and frame count must be positive");
+    }
+
+    SceneModel sceneModel(options);
+
+    sceneModel.setSize(size);
+    sceneModel.setMainObject(options.getArguments().at(0));
+
+    auto mainObject = sceneModel.getMainObject();
+    auto &meshStats = mainObject->getStats();
+
+    std::cout << mainObject->getVertexCount() << " vertices, "
+              << mainObject->getFaceCount() << " faces ("
+              << meshStats.degenerateFaceCount << " degenerate)\n";
+
+    auto buildStats = sceneModel.getBuildStats();
+
+    std::cout << "Built (" << getBuildProfileName(buildStats.profile) << ") in "
+              << buildStats.seconds << " s, "
+              << static_cast<double>(buildStats.bytes) / (1024.0 * 1024.0) << " MB, "
+              << static_cast<double>(sceneModel.getMemoryUsage()) / (1024.0 * 1024.0) << " MB in use\n";
+
+    if (options.getBool("tune", false)) {
+        tune(sceneModel, frameCount, outputPath);
+        return 0;
+    }
+
+    std::ofstream timing(outputPath + "/timing.csv");
+
+    if (timing.fail()) {
+        throw std::runtime_error("Failed to open " + outputPath + "/timing.csv");
+    }
+
+    timing << "frame,seconds,primary_rays,shadow_rays,reflection_rays,mrays_per_second,samples,convergence,reprojected_pixels\n";
+
+    double totalTime = 0.0;
+    long long totalRayCount = 0;
+
+    for (int frame = 0; frame < frameCount; frame++) {
+        sceneModel.render();
+
+        auto &stats = sceneModel.getRayStats();
+        auto frameTime = sceneModel.getGovernor().getFrameTime();
+
+        totalTime += frameTime;
+        totalRayCount += stats.getRayCount();
+
+        timing << frame << ","
+               << frameTime << ","
+               << stats.primaryRays << ","
+               << stats.shadowRays << ","
+               << stats.reflectionRays << ","
+               << sceneModel.getRPS() / 1000000.0f << ","
+               << sceneModel.getSampleCount() << ","
+               << sceneModel.getConvergence() << ","
+               << stats.reprojectedPixels << "\n";
+
+        if (saveImages) {
+            std::stringstream path;
+            path << outputPath << "/frame_" << std::setw(4) << std::setfill('0') << frame << ".ppm";
+            writePPM(path.str(), sceneModel.getSize(), sceneModel.getPixelFormat(), sceneModel.getPixels());
+        }
+    }
+
+    std::cout << frameCount << " frames in " << totalTime << " s, "
+              << static_cast<double>(frameCount) / totalTime << " FPS, "
+              << static_cast<double>(totalRayCount) / totalTime / 1000000.0 << " Mrays/s\n";
+
+    if (sceneModel.isProgressive()) {
+        std::cout << sceneModel.getSampleCount() << " samples per pixel, largest tile error "
+                  << sceneModel.getConvergence() << (sceneModel.isConverged() ? " (converged)\n" : "\n");
+    }
+
+    return 0;
+}
+catch (const std::exception &error) {
+    std::cout << "Error: " << error.what() << "\n";
+    return 1;
+}
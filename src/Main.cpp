@@ -5,10 +5,35 @@
 #include <pmmintrin.h>
 
 #include "App.hpp"
+#include "base/Options.hpp"
 
 int main(int argc, char *argv[]) try {
-    if (argc < 2) {
-        std::cout << "Usage: " << argv[0] << " (Models' directory)\n";
+    Options options(argc, argv);
+
+    if (options.getArguments().empty()) {
+        std::cout << "Usage: " << argv[0] << " (Models' directory) [Options]\n"
+                  << "\n"
+                  << "Options:\n"
+                  << "  --governor=(uncapped|target-fps|target-mrays|power-save)\n"
+                  << "  --governor-target=(FPS or Mrays/s)\n"
+                  << "  --mesh-cache=(directory, empty to disable, default: user cache directory)\n"
+                  << "  --mesh-cache-size=(MB, 0 for no limit, default: 4096)\n"
+                  << "  --build=(fast-load|balanced|high-quality, default: balanced)\n"
+                  << "  --memory-budget=(MB, default: 0 = unlimited)\n"
+                  << "  --threads=(Embree threads) --isa=(sse4.2|avx|avx2|avx512) --set-affinity\n"
+                  << "  --frequency-level=(simd128|simd256|simd512)\n"
+                  << "  --render-threads=(count) --pin-cpus=(e.g. 0-3,8)\n"
+                  << "  --fps=(GUI refresh rate, default: 60)\n"
+                  << "  --target-frame-time=(ms, default: 0 = render at the view's resolution)\n"
+                  << "  --min-scale=(default: 0.25) --max-scale=(default: 1)\n"
+                  << "  --animate=(1|0, default: 1) --animate-lights=(1|0, default: 1, 0 with --reproject=1)\n"
+                  << "  --pixel-format=(rgba32f|rgba16f|rgb10a2|rgba8-srgb, default: rgba32f)\n"
+                  << "  --progressive=(1|0, default: 0) --max-samples=(count, default: 256)\n"
+                  << "  --convergence=(error of a tile to stop sampling it at, default: 0.001)\n"
+                  << "  --reproject=(1|0, default: 0) --reproject-age=(frames, default: 4)\n"
+                  << "  --tile-size=(multiple of 4|auto, default: 8) --tile-order=(row-major|morton|hilbert)\n"
+                  << "  --partitioner=(auto|affinity|static|simple) --grain-size=(tiles, default: 1)\n"
+                  << "  --config=(file of name=value lines, overridden by the command line)\n";
         return 0;
         //argv[1] = "../../../object/StarLab";
     }
@@ -17,7 +42,7 @@ int main(int argc, char *argv[]) try {
     _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
     _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
 
-    App app(argc, argv);
+    App app(argc, argv, options);
     app.exec(); // NOLINT(readability-static-accessed-through-instance)
 
     return 0;
@@ -0,0 +1,58 @@
+#include "BuildProfile.hpp"
+
+#include <stdexcept>
+
+BuildProfile parseBuildProfile(const std::string &name) {
+    for (auto profile : getBuildProfiles()) {
+        if (getBuildProfileName(profile) == name) {
+            return profile;
+        }
+    }
+
+    throw std::runtime_error("Unknown build profile: " + name);
+}
+
+std::string getBuildProfileName(BuildProfile profile) {
+    switch (profile) {
+        case BuildProfile::FastLoad:
+            return "fast-load";
+        case BuildProfile::HighQuality:
+            return "high-quality";
+        default:
+            return "balanced";
+    }
+}
+
+const std::vector<BuildProfile> &getBuildProfiles() {
+    static const std::vector<BuildProfile> profiles = {
+            BuildProfile::FastLoad,
+            BuildProfile::Balanced,
+            BuildProfile::HighQuality
+    };
+
+    return profiles;
+}
+
+RTCBuildQuality getBuildQuality(BuildProfile profile) {
+    switch (profile) {
+        case BuildProfile::FastLoad:
+            return RTC_BUILD_QUALITY_LOW;
+        case BuildProfile::HighQuality:
+            return RTC_BUILD_QUALITY_HIGH;
+        default:
+            return RTC_BUILD_QUALITY_MEDIUM;
+    }
+}
+
+RTCSceneFlags getSceneFlags(BuildProfile profile) {
+    switch (profile) {
+        case BuildProfile::FastLoad:
+            // Smaller BVH nodes: less memory to allocate and fill.
+            return RTC_SCENE_FLAG_COMPACT;
+        case BuildProfile::HighQuality:
+            // Watertight traversal, so no rays slip through the edges of the room and the mirror.
+            return RTC_SCENE_FLAG_ROBUST;
+        default:
+            return RTC_SCENE_FLAG_NONE;
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <embree3/rtcore.h>
+
+#include <string>
+#include <vector>
+
+// Embree build settings, from quick loading to fast tracing.
+enum class BuildProfile {
+    FastLoad,
+    Balanced,
+    HighQuality
+};
+
+// Time and Embree memory a scene build took.
+struct BuildStats {
+    BuildProfile profile;
+    double seconds;
+    long long bytes;
+};
+
+BuildProfile parseBuildProfile(const std::string &name);
+std::string getBuildProfileName(BuildProfile profile);
+const std::vector<BuildProfile> &getBuildProfiles();
+
+RTCBuildQuality getBuildQuality(BuildProfile profile);
+RTCSceneFlags getSceneFlags(BuildProfile profile);
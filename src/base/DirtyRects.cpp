@@ -0,0 +1,71 @@
+#include "DirtyRects.hpp"
+
+#include <algorithm>
+
+std::vector<glm::ivec4> getDirtyRects(
+        const glm::ivec2 &size,
+        int tileSize,
+        const std::vector<long long> &tileFrames,
+        long long frame
+) {
+    std::vector<glm::ivec4> rects;
+
+    if (tileSize <= 0) {
+        rects.emplace_back(0, 0, size.x, size.y);
+        return rects;
+    }
+
+    int numTilesX = (size.x + tileSize - 1) / tileSize;
+    int numTilesY = (size.y + tileSize - 1) / tileSize;
+
+    if (tileFrames.size() != static_cast<size_t>(numTilesX * numTilesY)) {
+        rects.emplace_back(0, 0, size.x, size.y);
+        return rects;
+    }
+
+    // Rectangles reaching the bottom of the previous tile row, and of the current one.
+    std::vector<size_t> aboveRects;
+    std::vector<size_t> currentRects;
+
+    for (int tileY = 0; tileY < numTilesY; tileY++) {
+        auto isDirty = [&](int tileX) {
+            return tileFrames[tileY * numTilesX + tileX] > frame;
+        };
+
+        int y0 = tileY * tileSize;
+        int y1 = (std::min)(y0 + tileSize, size.y);
+
+        for (int tileX = 0; tileX < numTilesX;) {
+            if (!isDirty(tileX)) {
+                tileX++;
+                continue;
+            }
+
+            int begin = tileX;
+
+            while (tileX < numTilesX && isDirty(tileX)) {
+                tileX++;
+            }
+
+            int x0 = begin * tileSize;
+            int x1 = (std::min)(tileX * tileSize, size.x);
+
+            auto above = std::find_if(aboveRects.begin(), aboveRects.end(), [&](size_t index) {
+                return rects[index].x == x0 && rects[index].z == x1 - x0;
+            });
+
+            if (above != aboveRects.end()) {
+                rects[*above].w += y1 - y0;
+                currentRects.push_back(*above);
+            } else {
+                rects.emplace_back(x0, y0, x1 - x0, y1 - y0);
+                currentRects.push_back(rects.size() - 1);
+            }
+        }
+
+        std::swap(aboveRects, currentRects);
+        currentRects.clear();
+    }
+
+    return rects;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Rectangles (x, y, width, height) in pixels, covering the tiles changed after the given frame.
+// tileFrames holds the last frame each tile changed in, row by row. Unknown tiles make the whole image dirty.
+// Dirty tiles next to each other in a row become one span, and equal spans of consecutive rows one rectangle.
+std::vector<glm::ivec4> getDirtyRects(
+        const glm::ivec2 &size,
+        int tileSize,
+        const std::vector<long long> &tileFrames,
+        long long frame
+);
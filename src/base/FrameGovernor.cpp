@@ -0,0 +1,132 @@
+#include "FrameGovernor.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+static float computeDurationInSeconds(
+        const std::chrono::steady_clock::time_point &startTime,
+        const std::chrono::steady_clock::time_point &endTime
+) {
+    return std::chrono::duration_cast<std::chrono::duration<float>>(endTime - startTime).count();
+}
+
+static float getDefaultTarget(FrameGovernor::Policy policy) {
+    switch (policy) {
+        case FrameGovernor::Policy::TargetFPS:
+            return 60.0f;
+        case FrameGovernor::Policy::TargetRPS:
+            return 24.5f;
+        case FrameGovernor::Policy::PowerSave:
+            return 15.0f;
+        default:
+            return 0.0f;
+    }
+}
+
+FrameGovernor::FrameGovernor(Policy policy, float target)
+        : m_policy(policy), m_target(target > 0.0f ? target : getDefaultTarget(policy)) {
+    m_startTime = Clock::now();
+}
+
+FrameGovernor::Policy FrameGovernor::parsePolicy(const std::string &name) {
+    for (auto policy : getPolicies()) {
+        if (getPolicyName(policy) == name) {
+            return policy;
+        }
+    }
+
+    throw std::runtime_error("Unknown frame governor policy: " + name);
+}
+
+std::string FrameGovernor::getPolicyName(Policy policy) {
+    switch (policy) {
+        case Policy::TargetFPS:
+            return "target-fps";
+        case Policy::TargetRPS:
+            return "target-mrays";
+        case Policy::PowerSave:
+            return "power-save";
+        default:
+            return "uncapped";
+    }
+}
+
+const std::vector<FrameGovernor::Policy> &FrameGovernor::getPolicies() {
+    static const std::vector<Policy> policies = {
+            Policy::Uncapped,
+            Policy::TargetFPS,
+            Policy::TargetRPS,
+            Policy::PowerSave
+    };
+
+    return policies;
+}
+
+void FrameGovernor::setPolicy(Policy policy, float target) {
+    m_target = (target > 0.0f) ? target : getDefaultTarget(policy);
+    m_policy = policy;
+}
+
+FrameGovernor::Policy FrameGovernor::getPolicy() const {
+    return m_policy;
+}
+
+float FrameGovernor::getTarget() const {
+    return m_target;
+}
+
+void FrameGovernor::startFrame() {
+    m_startTime = Clock::now();
+}
+
+void FrameGovernor::endFrame(long long rayCount) {
+    m_workTime = computeDurationInSeconds(m_startTime, Clock::now());
+
+    Policy policy = m_policy;
+    float target = m_target;
+    float period = m_workTime;
+
+    switch (policy) {
+        case Policy::TargetFPS:
+            period = 1.0f / target;
+            break;
+        case Policy::TargetRPS:
+            period = static_cast<float>(rayCount) / (target * 1000000.0f);
+            break;
+        case Policy::PowerSave:
+            // Cap the frame rate, and never keep the cores busy for more than half of the time.
+            period = (std::max)(1.0f / target, 2.0f * m_workTime);
+            break;
+        default:
+            break;
+    }
+
+    // Sleep only when the policy asks for it.
+    if (period > m_workTime) {
+        std::this_thread::sleep_for(std::chrono::duration<float>(period - m_workTime));
+    }
+
+    m_frameTime = computeDurationInSeconds(m_startTime, Clock::now());
+    m_headroom = (period > 0.0f) ? (std::max)(0.0f, 1.0f - m_workTime / period) : 0.0f;
+
+    if (m_frameTime > 0.0f) {
+        m_rps = static_cast<float>(rayCount) / m_frameTime;
+    }
+}
+
+float FrameGovernor::getRPS() const {
+    return m_rps;
+}
+
+float FrameGovernor::getFrameTime() const {
+    return m_frameTime;
+}
+
+float FrameGovernor::getWorkTime() const {
+    return m_workTime;
+}
+
+float FrameGovernor::getHeadroom() const {
+    return m_headroom;
+}
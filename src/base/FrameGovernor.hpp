@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+class FrameGovernor {
+public:
+    enum class Policy {
+        Uncapped,
+        TargetFPS,
+        TargetRPS,
+        PowerSave
+    };
+
+    explicit FrameGovernor(Policy policy = Policy::Uncapped, float target = 0.0f);
+
+    static Policy parsePolicy(const std::string &name);
+    static std::string getPolicyName(Policy policy);
+    static const std::vector<Policy> &getPolicies();
+
+    // Target is in frames/s for TargetFPS and PowerSave, and in Mrays/s for TargetRPS.
+    // Zero or less picks the policy's default target.
+    void setPolicy(Policy policy, float target = 0.0f);
+
+    Policy getPolicy() const;
+    float getTarget() const;
+
+    void startFrame();
+    void endFrame(long long rayCount);
+
+    float getRPS() const;
+    float getFrameTime() const;
+    float getWorkTime() const;
+    float getHeadroom() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::atomic<Policy> m_policy;
+    std::atomic<float> m_target;
+
+    Clock::time_point m_startTime;
+    float m_rps = 0.0f;
+    float m_frameTime = 0.0f;
+    float m_workTime = 0.0f;
+    float m_headroom = 0.0f;
+};
@@ -0,0 +1,39 @@
+#include "Image.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+static unsigned char toByte(glm::f32 value) {
+    return static_cast<unsigned char>((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+void writePPM(const std::string &path, const glm::ivec2 &size, PixelFormat format, const std::vector<unsigned char> &pixels) {
+    std::ofstream out(path, std::ios::binary);
+
+    if (out.fail()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    out << "P6\n" << size.x << " " << size.y << "\n255\n";
+
+    std::vector<unsigned char> row(static_cast<size_t>(size.x) * 3);
+    auto pixelSize = getPixelSize(format);
+
+    for (int y = size.y - 1; y >= 0; y--) {
+        for (int x = 0; x < size.x; x++) {
+            auto index = (static_cast<size_t>(y) * size.x + x) * pixelSize;
+            auto color = decodePixel(format, &pixels[index]);
+
+            row[x * 3] = toByte(color.r);
+            row[x * 3 + 1] = toByte(color.g);
+            row[x * 3 + 2] = toByte(color.b);
+        }
+
+        out.write(reinterpret_cast<const char *>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+
+    if (out.fail()) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
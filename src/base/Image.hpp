@@ -0,0 +1,11 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "PixelFormat.hpp"
+
+// Writes pixels of the format (bottom row first, as uploaded to OpenGL) to a binary PPM file.
+void writePPM(const std::string &path, const glm::ivec2 &size, PixelFormat format, const std::vector<unsigned char> &pixels);
@@ -0,0 +1,109 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <windows.h>
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+    m_file = CreateFileA(
+            path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr
+    );
+
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+        CloseHandle(m_file);
+        throw std::runtime_error("Failed to map " + path);
+    }
+
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+    if (m_mapping != nullptr) {
+        m_data = static_cast<unsigned char *>(MapViewOfFile(m_mapping, FILE_MAP_COPY, 0, 0, 0));
+    }
+
+    if (m_data == nullptr) {
+        if (m_mapping != nullptr) {
+            CloseHandle(m_mapping);
+        }
+
+        CloseHandle(m_file);
+        throw std::runtime_error("Failed to map " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mapping);
+    CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    int file = open(path.c_str(), O_RDONLY);
+
+    if (file < 0) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    struct stat status = {};
+
+    if (fstat(file, &status) != 0 || status.st_size == 0) {
+        close(file);
+        throw std::runtime_error("Failed to map " + path);
+    }
+
+    m_size = static_cast<size_t>(status.st_size);
+
+    // Private and writable, so the pages are copied only if someone writes to them.
+    void *data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Failed to map " + path);
+    }
+
+    madvise(data, m_size, MADV_WILLNEED);
+    m_data = static_cast<unsigned char *>(data);
+}
+
+MappedFile::~MappedFile() {
+    munmap(m_data, m_size);
+}
+
+#endif
+
+unsigned char *MappedFile::getData() const {
+    return m_data;
+}
+
+size_t MappedFile::getSize() const {
+    return m_size;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+// Read-only view of a whole file through a private (copy-on-write) memory mapping.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    unsigned char *getData() const;
+    size_t getSize() const;
+
+private:
+    unsigned char *m_data = nullptr;
+    size_t m_size = 0;
+
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
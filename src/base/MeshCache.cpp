@@ -0,0 +1,441 @@
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+#include "PLYReader.hpp"
+
+#include <tbb/tbb.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#include <process.h>
+#include <share.h>
+#include <sys/utime.h>
+
+#else
+
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <sstream>
+
+static const char cacheMagic[8] = {'L', 'U', 'C', 'Y', 'M', 'S', 'H', '\0'};
+
+// Bump whenever the layout below or Object::Box/Stats change.
+static const std::uint32_t cacheVersion = 2;
+
+// Followed by the source path, the vertices (plus padding) and the faces at the given offsets.
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t pathLength;
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime; // Nanoseconds, so edits within the same second still invalidate the entry.
+    std::uint64_t vertexCount;
+    std::uint64_t faceCount;
+    std::uint64_t verticesOffset;
+    std::uint64_t facesOffset;
+    Object::Box aabb;
+    Object::Stats stats;
+};
+
+struct SourceInfo {
+    std::uint64_t size;
+    std::int64_t time;
+};
+
+struct CacheEntry {
+    std::string path;
+    std::uint64_t size;
+    std::int64_t time;
+};
+
+static std::uint64_t alignOffset(std::uint64_t offset, std::uint64_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static bool getSourceInfo(const std::string &path, SourceInfo &info) {
+    struct stat status;
+
+    if (stat(path.c_str(), &status) != 0) {
+        return false;
+    }
+
+    info.size = static_cast<std::uint64_t>(status.st_size);
+
+#if defined(_WIN32)
+    info.time = static_cast<std::int64_t>(status.st_mtime) * 1000000000;
+#elif defined(__APPLE__)
+    info.time = static_cast<std::int64_t>(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+    info.time = static_cast<std::int64_t>(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+
+    return true;
+}
+
+// Creates the directory if needed and checks that only the current user can use it.
+static bool preparePrivateDirectory(const std::string &path) {
+#ifdef _WIN32
+    _mkdir(path.c_str());
+
+    struct _stat status;
+    return _stat(path.c_str(), &status) == 0 && (status.st_mode & _S_IFDIR) != 0;
+#else
+    mkdir(path.c_str(), 0700);
+
+    struct stat status;
+
+    return lstat(path.c_str(), &status) == 0
+           && S_ISDIR(status.st_mode)
+           && status.st_uid == geteuid()
+           && (status.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+}
+
+// Opens a new file next to the cache entry that no other writer (or planted link) can share.
+static std::FILE *createTemporaryFile(const std::string &cachePath, std::string &temporaryPath) {
+#ifdef _WIN32
+    static std::atomic<unsigned int> counter(0);
+
+    for (int attempt = 0; attempt < 16; attempt++) {
+        temporaryPath = cachePath + "." + std::to_string(_getpid())
+                        + "." + std::to_string(counter++) + ".tmp";
+
+        int file = -1;
+        _sopen_s(
+                &file,
+                temporaryPath.c_str(),
+                _O_WRONLY | _O_CREAT | _O_EXCL | _O_BINARY,
+                _SH_DENYRW,
+                _S_IREAD | _S_IWRITE
+        );
+
+        if (file >= 0) {
+            return _fdopen(file, "wb");
+        }
+    }
+
+    return nullptr;
+#else
+    std::string name = cachePath + ".XXXXXX";
+
+    // mkstemp opens with O_CREAT | O_EXCL and mode 0600.
+    int file = mkstemp(&name[0]);
+
+    if (file < 0) {
+        return nullptr;
+    }
+
+    temporaryPath = name;
+    auto output = fdopen(file, "wb");
+
+    if (output == nullptr) {
+        close(file);
+        std::remove(temporaryPath.c_str());
+    }
+
+    return output;
+#endif
+}
+
+// Entries in the directory, with their last use. (Modification time, which load() refreshes)
+static std::vector<CacheEntry> listEntries(const std::string &directory) {
+    std::vector<CacheEntry> entries;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    auto search = FindFirstFileA((directory + "/lucy_*.mesh").c_str(), &data);
+
+    if (search == INVALID_HANDLE_VALUE) {
+        return entries;
+    }
+
+    do {
+        auto size = (static_cast<std::uint64_t>(data.nFileSizeHigh) << 32u) | data.nFileSizeLow;
+        auto time = (static_cast<std::int64_t>(data.ftLastWriteTime.dwHighDateTime) << 32u)
+                    | data.ftLastWriteTime.dwLowDateTime;
+
+        entries.push_back({directory + "/" + data.cFileName, size, time});
+    } while (FindNextFileA(search, &data));
+
+    FindClose(search);
+#else
+    auto stream = opendir(directory.c_str());
+
+    if (stream == nullptr) {
+        return entries;
+    }
+
+    while (auto entry = readdir(stream)) {
+        std::string name = entry->d_name;
+        SourceInfo info;
+
+        if (name.size() > 10
+            && name.compare(0, 5, "lucy_") == 0
+            && name.compare(name.size() - 5, 5, ".mesh") == 0
+            && getSourceInfo(directory + "/" + name, info)) {
+            entries.push_back({directory + "/" + name, info.size, info.time});
+        }
+    }
+
+    closedir(stream);
+#endif
+
+    return entries;
+}
+
+static unsigned int findMaxIndex(const Object::Face *faces, size_t faceCount) {
+    return tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, faceCount, 64 * 1024),
+            0u,
+            [faces](const tbb::blocked_range<size_t> &range, unsigned int result) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    result = (std::max)({result, faces[i].x, faces[i].y, faces[i].z});
+                }
+
+                return result;
+            },
+            [](unsigned int a, unsigned int b) {
+                return (std::max)(a, b);
+            }
+    );
+}
+
+MeshCache::MeshCache(const std::string &directory, long long maxBytes)
+        : m_directory(directory), m_maxBytes(maxBytes) {
+}
+
+std::string MeshCache::getDefaultDirectory() {
+#ifdef _WIN32
+    auto base = std::getenv("LOCALAPPDATA");
+
+    if (base == nullptr || *base == '\0') {
+        return "";
+    }
+
+    std::string directory = std::string(base) + "/LucyViewer";
+#else
+    std::string base;
+    auto cacheHome = std::getenv("XDG_CACHE_HOME");
+    auto home = std::getenv("HOME");
+
+    if (cacheHome != nullptr && *cacheHome == '/') {
+        base = cacheHome;
+    } else if (home != nullptr && *home != '\0') {
+        base = std::string(home) + "/.cache";
+        mkdir(base.c_str(), 0700);
+    } else {
+        return "";
+    }
+
+    std::string directory = base + "/LucyViewer";
+#endif
+
+    // Without a private directory, run without the cache rather than share one with other users.
+    return preparePrivateDirectory(directory) ? directory : "";
+}
+
+Object::Mesh MeshCache::load(const std::string &sourcePath) const {
+    SourceInfo info;
+
+    if (m_directory.empty() || !getSourceInfo(sourcePath, info)) {
+        return readPLY(sourcePath);
+    }
+
+    std::shared_ptr<MappedFile> file;
+
+    try {
+        file = std::make_shared<MappedFile>(getCachePath(sourcePath));
+    } catch (const std::exception &) {
+        return readPLY(sourcePath);
+    }
+
+    auto data = file->getData();
+    auto size = file->getSize();
+
+    if (size < sizeof(CacheHeader)) {
+        return readPLY(sourcePath);
+    }
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(CacheHeader));
+
+    // Anything unexpected means a stale, foreign or damaged file: fall back to the source, which rewrites the cache.
+    // The counts are checked against the file size first, so the products below can't overflow.
+    bool isCurrent = std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0
+                     && header.version == cacheVersion
+                     && header.sourceSize == info.size
+                     && header.sourceTime == info.time
+                     && header.pathLength == sourcePath.size()
+                     && sizeof(CacheHeader) + header.pathLength <= size
+                     && std::memcmp(data + sizeof(CacheHeader), sourcePath.data(), sourcePath.size()) == 0
+                     && header.vertexCount <= size / sizeof(Object::Vertex)
+                     && header.faceCount <= size / sizeof(Object::Face)
+                     && header.verticesOffset == alignOffset(sizeof(CacheHeader) + header.pathLength, 16)
+                     && header.facesOffset == alignOffset(
+                             header.verticesOffset + header.vertexCount * sizeof(Object::Vertex)
+                             + Object::Mesh::vertexPadding,
+                             16
+                     )
+                     && header.facesOffset + header.faceCount * sizeof(Object::Face) == size;
+
+    if (!isCurrent) {
+        return readPLY(sourcePath);
+    }
+
+    auto faces = reinterpret_cast<Object::Face *>(data + header.facesOffset);
+
+    // Embree doesn't check indices, so never trust the stored stats for them.
+    if (header.faceCount > 0 && findMaxIndex(faces, static_cast<size_t>(header.faceCount)) >= header.vertexCount) {
+        return readPLY(sourcePath);
+    }
+
+    Object::Mesh mesh;
+    mesh.storage = file;
+    mesh.vertices = reinterpret_cast<Object::Vertex *>(data + header.verticesOffset);
+    mesh.vertexCount = static_cast<size_t>(header.vertexCount);
+    mesh.faces = faces;
+    mesh.faceCount = static_cast<size_t>(header.faceCount);
+    mesh.validated = true;
+    mesh.aabb = header.aabb;
+    mesh.stats = header.stats;
+
+    // Marks the entry as recently used, so eviction takes the others first.
+#ifdef _WIN32
+    _utime(getCachePath(sourcePath).c_str(), nullptr);
+#else
+    utime(getCachePath(sourcePath).c_str(), nullptr);
+#endif
+
+    return mesh;
+}
+
+void MeshCache::store(const std::string &sourcePath, const Object::Mesh &mesh) const {
+    SourceInfo info;
+
+    if (m_directory.empty() || !mesh.validated || !getSourceInfo(sourcePath, info)) {
+        return;
+    }
+
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(CacheHeader));
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+
+    header.version = cacheVersion;
+    header.pathLength = static_cast<std::uint32_t>(sourcePath.size());
+    header.sourceSize = info.size;
+    header.sourceTime = info.time;
+    header.vertexCount = mesh.vertexCount;
+    header.faceCount = mesh.faceCount;
+    header.verticesOffset = alignOffset(sizeof(CacheHeader) + sourcePath.size(), 16);
+    header.facesOffset = alignOffset(
+            header.verticesOffset + mesh.vertexCount * sizeof(Object::Vertex) + Object::Mesh::vertexPadding,
+            16
+    );
+    header.aabb = mesh.aabb;
+    header.stats = mesh.stats;
+
+    auto fileSize = header.facesOffset + mesh.faceCount * sizeof(Object::Face);
+
+    // Would evict everything else, and still not fit.
+    if (m_maxBytes > 0 && fileSize > static_cast<std::uint64_t>(m_maxBytes)) {
+        return;
+    }
+
+    auto cachePath = getCachePath(sourcePath);
+    std::string temporaryPath;
+    auto output = createTemporaryFile(cachePath, temporaryPath);
+
+    if (output == nullptr) {
+        return;
+    }
+
+    std::uint64_t offset = 0;
+    bool failed = false;
+
+    auto writeAt = [output, &offset, &failed](std::uint64_t position, const void *data, std::uint64_t size) {
+        // Gaps are at most the vertex padding plus the 16-byte alignment.
+        static const char zeros[32] = {};
+        auto gap = static_cast<size_t>(position - offset);
+
+        failed = failed
+                 || std::fwrite(zeros, 1, gap, output) != gap
+                 || std::fwrite(data, 1, static_cast<size_t>(size), output) != size;
+        offset = position + size;
+    };
+
+    writeAt(0, &header, sizeof(CacheHeader));
+    writeAt(offset, sourcePath.data(), sourcePath.size());
+    writeAt(header.verticesOffset, mesh.vertices, mesh.vertexCount * sizeof(Object::Vertex));
+    writeAt(header.facesOffset, mesh.faces, mesh.faceCount * sizeof(Object::Face));
+
+    if (std::fclose(output) != 0 || failed) {
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    // Replace the old entry in one step, so a concurrent reader never sees a half-written file.
+#ifdef _WIN32
+    std::remove(cachePath.c_str());
+#endif
+
+    if (std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    evict(cachePath);
+}
+
+void MeshCache::evict(const std::string &keptPath) const {
+    if (m_maxBytes <= 0) {
+        return;
+    }
+
+    auto entries = listEntries(m_directory);
+    std::uint64_t totalSize = 0;
+
+    for (auto &entry : entries) {
+        totalSize += entry.size;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const CacheEntry &a, const CacheEntry &b) {
+        return a.time < b.time;
+    });
+
+    for (auto &entry : entries) {
+        if (totalSize <= static_cast<std::uint64_t>(m_maxBytes)) {
+            break;
+        }
+
+        if (entry.path != keptPath && std::remove(entry.path.c_str()) == 0) {
+            totalSize -= entry.size;
+        }
+    }
+}
+
+std::string MeshCache::getCachePath(const std::string &sourcePath) const {
+    std::stringstream ss;
+
+    ss << m_directory << "/lucy_" << std::hex << std::hash<std::string>()(sourcePath) << ".mesh";
+
+    return ss.str();
+}
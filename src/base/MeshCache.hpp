@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Object.hpp"
+
+// On-disk cache of validated meshes, keyed by the source path, size and modification time.
+// Cached meshes are memory-mapped and handed to Embree as they are, with their box and stats already filled in.
+// Beyond the size limit, the least recently loaded entries are removed.
+class MeshCache {
+public:
+    // An empty directory disables the cache. Zero or less maxBytes means no limit.
+    MeshCache(const std::string &directory, long long maxBytes);
+
+    // A per-user directory (e.g. $XDG_CACHE_HOME/LucyViewer), created private to the user.
+    // Empty if no such directory can be used.
+    static std::string getDefaultDirectory();
+
+    // Reads the mesh from the cache if it is up to date, and from the PLY file otherwise.
+    Object::Mesh load(const std::string &sourcePath) const;
+
+    // Stores a validated mesh. Failures only mean that the next load is slower, so they are ignored.
+    void store(const std::string &sourcePath, const Object::Mesh &mesh) const;
+
+private:
+    std::string getCachePath(const std::string &sourcePath) const;
+
+    // Removes the oldest entries until the cache fits the limit. The given entry is kept.
+    void evict(const std::string &keptPath) const;
+
+    std::string m_directory;
+    long long m_maxBytes;
+};
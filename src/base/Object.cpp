@@ -1,33 +1,56 @@
 #include "Object.hpp"
+#include "PLYReader.hpp"
 
-#define TINYPLY_IMPLEMENTATION
-
-#include <tinyply.h>
+#include <tbb/tbb.h>
+#include <xmmintrin.h>
 
+#include <algorithm>
+#include <limits>
+#include <new>
 #include <stdexcept>
+#include <string>
 
-Object::Object(RTCDevice device, RTCScene scene, const std::string &path) {
-    std::ifstream in(path, std::ios::binary);
+// Vertices and faces handled per task.
+static const size_t grainSize = 64 * 1024;
 
-    if (in.fail()) {
-        throw std::runtime_error("Failed to open " + path);
-    }
+struct BoxReduction {
+    __m128 boxMin;
+    __m128 boxMax;
+};
+
+static size_t alignSize(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
 
-    tinyply::PlyFile file;
+Object::Mesh Object::Mesh::allocate(size_t vertexCount, size_t faceCount) {
+    size_t facesOffset = alignSize(vertexCount * sizeof(Vertex) + Mesh::vertexPadding, 16);
+    size_t size = facesOffset + faceCount * sizeof(Face);
 
-    file.parse_header(in);
-    auto vertices = file.request_properties_from_element("vertex", {"x", "y", "z"});
-    auto faces = file.request_properties_from_element("face", {"vertex_indices"}, 3);
-    file.read(in);
+    auto storage = std::shared_ptr<void>(::operator new(size), [](void *pointer) {
+        ::operator delete(pointer);
+    });
 
-    create(
-            device,
-            scene,
-            reinterpret_cast<Vertex *>(vertices->buffer.get()),
-            vertices->count,
-            reinterpret_cast<Face *>(faces->buffer.get()),
-            faces->count
-    );
+    auto bytes = static_cast<unsigned char *>(storage.get());
+
+    Mesh mesh;
+    mesh.storage = storage;
+    mesh.vertices = reinterpret_cast<Vertex *>(bytes);
+    mesh.vertexCount = vertexCount;
+    mesh.faces = reinterpret_cast<Face *>(bytes + facesOffset);
+    mesh.faceCount = faceCount;
+
+    // Keep the padding deterministic.
+    std::fill(bytes + vertexCount * sizeof(Vertex), bytes + facesOffset, static_cast<unsigned char>(0));
+
+    return mesh;
+}
+
+Object::Object(RTCDevice device, RTCScene scene, const std::string &path, RTCBuildQuality quality) {
+    create(device, scene, readPLY(path), quality);
+}
+
+Object::Object(RTCDevice device, RTCScene scene, Object::Mesh mesh, RTCBuildQuality quality) {
+    create(device, scene, std::move(mesh), quality);
 }
 
 Object::Object(
@@ -36,9 +59,15 @@ Object::Object(
         Object::Vertex *vertices,
         size_t vertexCount,
         Object::Face *faces,
-        size_t faceCount
+        size_t faceCount,
+        RTCBuildQuality quality
 ) {
-    create(device, scene, vertices, vertexCount, faces, faceCount);
+    auto mesh = Mesh::allocate(vertexCount, faceCount);
+
+    std::copy(vertices, vertices + vertexCount, mesh.vertices);
+    std::copy(faces, faces + faceCount, mesh.faces);
+
+    create(device, scene, std::move(mesh), quality);
 }
 
 Object::~Object() {
@@ -54,70 +83,170 @@ unsigned int Object::getGeometryID() const {
 }
 
 Object::Vertex *Object::getVertices() const {
-    return m_vertices;
+    return m_mesh.vertices;
 }
 
 Object::Face *Object::getFaces() const {
-    return m_faces;
+    return m_mesh.faces;
 }
 
 size_t Object::getVertexCount() const {
-    return m_vertexCount;
+    return m_mesh.vertexCount;
 }
 
 size_t Object::getFaceCount() const {
-    return m_faceCount;
+    return m_mesh.faceCount;
 }
 
 const Object::Box &Object::getAABB() const {
     return m_aabb;
 }
 
-void Object::create(
-        RTCDevice device,
-        RTCScene scene,
-        Object::Vertex *vertices,
-        size_t vertexCount,
-        Object::Face *faces,
-        size_t faceCount
-) {
+const Object::Stats &Object::getStats() const {
+    return m_stats;
+}
+
+const Object::Mesh &Object::getMesh() const {
+    return m_mesh;
+}
+
+void Object::create(RTCDevice device, RTCScene scene, Object::Mesh mesh, RTCBuildQuality quality) {
+    m_mesh = std::move(mesh);
+
+    // Embree reads out-of-range indices without checking them, so validate before creating the geometry.
+    if (m_mesh.validated) {
+        m_stats = m_mesh.stats;
+    } else {
+        computeStats();
+    }
+
     m_geometry = rtcNewGeometry(device, RTC_GEOMETRY_TYPE_TRIANGLE);
-    m_vertexCount = vertexCount;
-    m_faceCount = faceCount;
+    rtcSetGeometryBuildQuality(m_geometry, quality);
 
-    m_vertices = static_cast<Vertex *>(rtcSetNewGeometryBuffer(
+    // The mesh stays alive as long as this object, so Embree can use its buffers directly.
+    rtcSetSharedGeometryBuffer(
             m_geometry,
             RTC_BUFFER_TYPE_VERTEX,
             0,
             RTC_FORMAT_FLOAT3,
+            m_mesh.vertices,
+            0,
             sizeof(Vertex),
-            m_vertexCount
-    ));
+            m_mesh.vertexCount
+    );
 
-    m_faces = static_cast<Face *>(rtcSetNewGeometryBuffer(
+    rtcSetSharedGeometryBuffer(
             m_geometry,
             RTC_BUFFER_TYPE_INDEX,
             0,
             RTC_FORMAT_UINT3,
+            m_mesh.faces,
+            0,
             sizeof(Face),
-            m_faceCount
-    ));
+            m_mesh.faceCount
+    );
 
     rtcCommitGeometry(m_geometry);
     m_geometryID = rtcAttachGeometry(scene, m_geometry);
 
-    std::copy(vertices, vertices + m_vertexCount, m_vertices);
-    std::copy(faces, faces + m_faceCount, m_faces);
+    if (m_mesh.validated) {
+        m_aabb = m_mesh.aabb;
+    } else {
+        computeAABB();
 
-    for (size_t i = 0; i < m_vertexCount; i++) {
-        auto vertex = m_vertices[i];
-
-        m_aabb.boxMin = (glm::min)(m_aabb.boxMin, vertex);
-        m_aabb.boxMax = (glm::max)(m_aabb.boxMax, vertex);
+        m_mesh.validated = true;
+        m_mesh.aabb = m_aabb;
+        m_mesh.stats = m_stats;
     }
+}
 
+void Object::computeAABB() {
+    auto vertices = m_mesh.vertices;
+    auto infinity = std::numeric_limits<float>::infinity();
+    auto identity = BoxReduction{_mm_set1_ps(infinity), _mm_set1_ps(-infinity)};
+
+    // Each vertex is read with a 16-byte load, which the padding after the last vertex allows.
+    auto box = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, m_mesh.vertexCount, grainSize),
+            identity,
+            [vertices](const tbb::blocked_range<size_t> &range, BoxReduction result) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    auto vertex = _mm_loadu_ps(&vertices[i].x);
+
+                    result.boxMin = _mm_min_ps(result.boxMin, vertex);
+                    result.boxMax = _mm_max_ps(result.boxMax, vertex);
+                }
+
+                return result;
+            },
+            [](const BoxReduction &a, const BoxReduction &b) {
+                return BoxReduction{_mm_min_ps(a.boxMin, b.boxMin), _mm_max_ps(a.boxMax, b.boxMax)};
+            }
+    );
+
+    alignas(16) float boxMin[4];
+    alignas(16) float boxMax[4];
+
+    _mm_store_ps(boxMin, box.boxMin);
+    _mm_store_ps(boxMax, box.boxMax);
+
+    m_aabb.boxMin = {boxMin[0], boxMin[1], boxMin[2]};
+    m_aabb.boxMax = {boxMax[0], boxMax[1], boxMax[2]};
     m_aabb.center = (m_aabb.boxMin + m_aabb.boxMax) * 0.5f;
     m_aabb.extent = m_aabb.boxMax - m_aabb.boxMin;
     m_aabb.minExtent = (std::min)({m_aabb.extent.x, m_aabb.extent.y, m_aabb.extent.z});
     m_aabb.maxExtent = (std::max)({m_aabb.extent.x, m_aabb.extent.y, m_aabb.extent.z});
 }
+
+void Object::computeStats() {
+    auto vertices = m_mesh.vertices;
+    auto faces = m_mesh.faces;
+    auto vertexCount = m_mesh.vertexCount;
+    auto identity = Stats{0, std::numeric_limits<unsigned int>::max(), 0};
+
+    auto stats = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, m_mesh.faceCount, grainSize),
+            identity,
+            [vertices, faces, vertexCount](const tbb::blocked_range<size_t> &range, Stats result) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    auto face = faces[i];
+                    auto faceMin = (std::min)({face.x, face.y, face.z});
+                    auto faceMax = (std::max)({face.x, face.y, face.z});
+
+                    result.minIndex = (std::min)(result.minIndex, faceMin);
+                    result.maxIndex = (std::max)(result.maxIndex, faceMax);
+
+                    if (faceMax >= vertexCount) {
+                        continue;
+                    }
+
+                    auto normal = glm::cross(
+                            vertices[face.y] - vertices[face.x],
+                            vertices[face.z] - vertices[face.x]
+                    );
+
+                    if (glm::dot(normal, normal) == 0.0f) {
+                        result.degenerateFaceCount++;
+                    }
+                }
+
+                return result;
+            },
+            [](const Stats &a, const Stats &b) {
+                return Stats{
+                        a.degenerateFaceCount + b.degenerateFaceCount,
+                        (std::min)(a.minIndex, b.minIndex),
+                        (std::max)(a.maxIndex, b.maxIndex)
+                };
+            }
+    );
+
+    if (m_mesh.faceCount > 0 && stats.maxIndex >= vertexCount) {
+        throw std::runtime_error(
+                "Face index " + std::to_string(stats.maxIndex)
+                + " is out of range (" + std::to_string(vertexCount) + " vertices)"
+        );
+    }
+
+    m_stats = stats;
+}
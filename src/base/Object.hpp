@@ -1,10 +1,9 @@
 #pragma once
 
 #include <embree3/rtcore.h>
-#include <tinyply.h>
 #include <glm/glm.hpp>
 
-#include <fstream>
+#include <memory>
 #include <string>
 #include <limits>
 
@@ -22,7 +21,39 @@ public:
         float minExtent;
     };
 
-    Object(RTCDevice device, RTCScene scene, const std::string &path);
+    struct Stats {
+        size_t degenerateFaceCount;
+        unsigned int minIndex;
+        unsigned int maxIndex;
+    };
+
+    // Vertices and faces of a mesh in one allocation, which Embree shares instead of copying.
+    struct Mesh {
+        // Embree reads vertices with 16-byte loads, so the last vertex needs 4 more readable bytes.
+        static const size_t vertexPadding = sizeof(float);
+
+        std::shared_ptr<void> storage;
+        Vertex *vertices = nullptr;
+        size_t vertexCount = 0;
+        Face *faces = nullptr;
+        size_t faceCount = 0;
+
+        // Set once the box and stats below are known (e.g. read from the mesh cache), so they aren't computed again.
+        bool validated = false;
+        Box aabb;
+        Stats stats;
+
+        static Mesh allocate(size_t vertexCount, size_t faceCount);
+    };
+
+    Object(
+            RTCDevice device,
+            RTCScene scene,
+            const std::string &path,
+            RTCBuildQuality quality = RTC_BUILD_QUALITY_MEDIUM
+    );
+
+    Object(RTCDevice device, RTCScene scene, Mesh mesh, RTCBuildQuality quality = RTC_BUILD_QUALITY_MEDIUM);
 
     Object(
             RTCDevice device,
@@ -30,7 +61,8 @@ public:
             Vertex *vertices,
             size_t vertexCount,
             Face *faces,
-            size_t faceCount
+            size_t faceCount,
+            RTCBuildQuality quality = RTC_BUILD_QUALITY_MEDIUM
     );
 
     ~Object();
@@ -42,26 +74,22 @@ public:
     size_t getVertexCount() const;
     size_t getFaceCount() const;
     const Box &getAABB() const;
+    const Stats &getStats() const;
+    const Mesh &getMesh() const;
 
     //void setVertex(size_t index, const Vertex &vertex);
     //void setFace(size_t index, const Face &face);
 
 private:
-    void create(
-            RTCDevice device,
-            RTCScene scene,
-            Vertex *vertices,
-            size_t vertexCount,
-            Face *faces,
-            size_t faceCount
-    );
+    void create(RTCDevice device, RTCScene scene, Mesh mesh, RTCBuildQuality quality);
+    void computeAABB();
+    void computeStats();
 
     RTCGeometry m_geometry = nullptr;
     unsigned int m_geometryID = 0;
-    Vertex *m_vertices = nullptr;
-    Face *m_faces = nullptr;
-    size_t m_vertexCount = 0;
-    size_t m_faceCount = 0;
+    Mesh m_mesh;
+
+    Stats m_stats = {0, 0, 0};
 
     Box m_aabb = {
             {
@@ -0,0 +1,143 @@
+#include "Options.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+static std::string trim(const std::string &text) {
+    auto first = text.find_first_not_of(" \t\r");
+    auto last = text.find_last_not_of(" \t\r");
+
+    return (first == std::string::npos) ? "" : text.substr(first, last - first + 1);
+}
+
+static std::runtime_error createValueError(const std::string &name, const std::string &value) {
+    return std::runtime_error("Invalid value for --" + name + ": " + value);
+}
+
+Options::Options(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        // Options look like --name=value or --name. Everything else is a positional argument.
+        if (argument.compare(0, 2, "--") != 0) {
+            m_arguments.push_back(argument);
+            continue;
+        }
+
+        auto separator = argument.find('=');
+
+        if (separator == std::string::npos) {
+            set(argument.substr(2), "1");
+        } else {
+            set(argument.substr(2, separator - 2), argument.substr(separator + 1));
+        }
+    }
+
+    // The command line wins over the config file.
+    if (has("config")) {
+        load(getString("config"));
+    }
+}
+
+bool Options::has(const std::string &name) const {
+    return m_values.find(name) != m_values.end();
+}
+
+std::string Options::getString(const std::string &name, const std::string &defaultValue) const {
+    auto found = m_values.find(name);
+    return (found == m_values.end()) ? defaultValue : found->second;
+}
+
+int Options::getInt(const std::string &name, int defaultValue) const {
+    if (!has(name)) {
+        return defaultValue;
+    }
+
+    auto value = getString(name);
+
+    try {
+        size_t length = 0;
+        int result = std::stoi(value, &length);
+
+        if (length == value.size()) {
+            return result;
+        }
+    } catch (const std::exception &) {
+    }
+
+    throw createValueError(name, value);
+}
+
+float Options::getFloat(const std::string &name, float defaultValue) const {
+    if (!has(name)) {
+        return defaultValue;
+    }
+
+    auto value = getString(name);
+
+    try {
+        size_t length = 0;
+        float result = std::stof(value, &length);
+
+        if (length == value.size()) {
+            return result;
+        }
+    } catch (const std::exception &) {
+    }
+
+    throw createValueError(name, value);
+}
+
+bool Options::getBool(const std::string &name, bool defaultValue) const {
+    if (!has(name)) {
+        return defaultValue;
+    }
+
+    auto value = getString(name);
+
+    if (value == "1" || value == "true" || value == "on" || value == "yes") {
+        return true;
+    } else if (value == "0" || value == "false" || value == "off" || value == "no") {
+        return false;
+    }
+
+    throw createValueError(name, value);
+}
+
+const std::vector<std::string> &Options::getArguments() const {
+    return m_arguments;
+}
+
+void Options::set(const std::string &name, const std::string &value) {
+    m_values[name] = value;
+}
+
+void Options::load(const std::string &path) {
+    std::ifstream file(path);
+
+    if (file.fail()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    std::string line;
+
+    while (std::getline(file, line)) {
+        line = trim(line.substr(0, line.find('#')));
+
+        if (line.empty()) {
+            continue;
+        }
+
+        auto separator = line.find('=');
+        auto name = trim(line.substr(0, separator));
+        auto value = (separator == std::string::npos) ? "1" : trim(line.substr(separator + 1));
+
+        if (name.empty()) {
+            throw std::runtime_error("Invalid line in " + path + ": " + line);
+        }
+
+        if (!has(name)) {
+            set(name, value);
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+class Options {
+public:
+    Options() = default;
+    Options(int argc, char *argv[]);
+
+    bool has(const std::string &name) const;
+    std::string getString(const std::string &name, const std::string &defaultValue = "") const;
+    int getInt(const std::string &name, int defaultValue) const;
+    float getFloat(const std::string &name, float defaultValue) const;
+    bool getBool(const std::string &name, bool defaultValue) const;
+    const std::vector<std::string> &getArguments() const;
+
+    void set(const std::string &name, const std::string &value);
+
+    // Reads name=value lines. ('#' starts a comment) Options that are already set are kept.
+    void load(const std::string &path);
+
+private:
+    std::map<std::string, std::string> m_values;
+    std::vector<std::string> m_arguments;
+};
@@ -0,0 +1,475 @@
+#include "PLYReader.hpp"
+
+#define TINYPLY_IMPLEMENTATION
+
+#include <tinyply.h>
+#include <tbb/tbb.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+struct PLYProperty {
+    std::string name;
+    tinyply::Type type = tinyply::Type::INVALID;
+    bool isList = false;
+    tinyply::Type listType = tinyply::Type::INVALID;
+};
+
+struct PLYElement {
+    std::string name;
+    size_t count = 0;
+    std::vector<PLYProperty> properties;
+};
+
+struct PLYHeader {
+    std::string format;
+    std::vector<PLYElement> elements;
+};
+
+// Byte layout of binary vertex and face records which only differ from Object::Vertex/Object::Face by extra properties.
+struct PLYLayout {
+    size_t vertexStride = 0;
+    size_t positionOffsets[3] = {0, 0, 0};
+    size_t facePrefixSize = 0;
+    size_t faceSuffixSize = 0;
+    tinyply::Type faceCountType = tinyply::Type::INVALID;
+};
+
+// Keeps the mapped file alive for vertices used in place, next to the separately converted faces.
+struct MappedStorage {
+    std::shared_ptr<MappedFile> file;
+    std::shared_ptr<void> faces;
+};
+
+// Records converted per task.
+static const size_t chunkRecordCount = 64 * 1024;
+
+static tinyply::Type parseType(const std::string &name) {
+    if (name == "char" || name == "int8") {
+        return tinyply::Type::INT8;
+    } else if (name == "uchar" || name == "uint8") {
+        return tinyply::Type::UINT8;
+    } else if (name == "short" || name == "int16") {
+        return tinyply::Type::INT16;
+    } else if (name == "ushort" || name == "uint16") {
+        return tinyply::Type::UINT16;
+    } else if (name == "int" || name == "int32") {
+        return tinyply::Type::INT32;
+    } else if (name == "uint" || name == "uint32") {
+        return tinyply::Type::UINT32;
+    } else if (name == "float" || name == "float32") {
+        return tinyply::Type::FLOAT32;
+    } else if (name == "double" || name == "float64") {
+        return tinyply::Type::FLOAT64;
+    }
+
+    throw std::runtime_error("Unknown PLY property type: " + name);
+}
+
+static size_t getTypeSize(tinyply::Type type) {
+    return static_cast<size_t>(tinyply::PropertyTable[type].stride);
+}
+
+static bool isLittleEndian() {
+    uint32_t value = 1;
+    unsigned char byte = 0;
+
+    std::memcpy(&byte, &value, 1);
+    return byte == 1;
+}
+
+static PLYHeader parseHeader(std::istream &in, const std::string &path) {
+    PLYHeader header;
+    std::string line;
+
+    if (!std::getline(in, line) || line.compare(0, 3, "ply") != 0) {
+        throw std::runtime_error("Not a PLY file: " + path);
+    }
+
+    while (std::getline(in, line)) {
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+
+        std::stringstream ss(line);
+        std::string keyword;
+
+        ss >> keyword;
+
+        if (keyword == "format") {
+            ss >> header.format;
+        } else if (keyword == "element") {
+            PLYElement element;
+            ss >> element.name >> element.count;
+            header.elements.push_back(element);
+        } else if (keyword == "property") {
+            if (header.elements.empty()) {
+                throw std::runtime_error("PLY property without an element: " + path);
+            }
+
+            PLYProperty property;
+            std::string typeName;
+
+            ss >> typeName;
+
+            if (typeName == "list") {
+                std::string listTypeName;
+
+                ss >> listTypeName >> typeName;
+                property.isList = true;
+                property.listType = parseType(listTypeName);
+            }
+
+            property.type = parseType(typeName);
+            ss >> property.name;
+            header.elements.back().properties.push_back(property);
+        } else if (keyword == "end_header") {
+            return header;
+        }
+    }
+
+    throw std::runtime_error("Incomplete PLY header: " + path);
+}
+
+static size_t getFixedSize(const PLYElement &element) {
+    size_t size = 0;
+
+    for (auto &property : element.properties) {
+        if (property.isList) {
+            return 0;
+        }
+
+        size += getTypeSize(property.type);
+    }
+
+    return size;
+}
+
+static bool isIndexType(tinyply::Type type) {
+    return type == tinyply::Type::INT32 || type == tinyply::Type::UINT32;
+}
+
+static bool findBinaryLayout(const PLYHeader &header, PLYLayout &layout) {
+    if (header.format != "binary_little_endian" || !isLittleEndian()) {
+        return false;
+    }
+
+    for (auto &element : header.elements) {
+        if (element.name == "vertex") {
+            const char *names[3] = {"x", "y", "z"};
+            bool found[3] = {false, false, false};
+            size_t offset = 0;
+
+            for (auto &property : element.properties) {
+                if (property.isList) {
+                    return false;
+                }
+
+                for (int i = 0; i < 3; i++) {
+                    if (property.name == names[i] && property.type == tinyply::Type::FLOAT32) {
+                        layout.positionOffsets[i] = offset;
+                        found[i] = true;
+                    }
+                }
+
+                offset += getTypeSize(property.type);
+            }
+
+            if (!found[0] || !found[1] || !found[2]) {
+                return false;
+            }
+
+            layout.vertexStride = offset;
+        } else if (element.name == "face") {
+            bool found = false;
+
+            for (auto &property : element.properties) {
+                if (property.isList) {
+                    bool isIndices = property.name == "vertex_indices" || property.name == "vertex_index";
+
+                    if (found || !isIndices || !isIndexType(property.type)) {
+                        return false;
+                    }
+
+                    layout.faceCountType = property.listType;
+                    found = true;
+                } else if (found) {
+                    layout.faceSuffixSize += getTypeSize(property.type);
+                } else {
+                    layout.facePrefixSize += getTypeSize(property.type);
+                }
+            }
+
+            if (!found) {
+                return false;
+            }
+        } else if (getFixedSize(element) == 0 && element.count > 0) {
+            // Elements with lists cannot be skipped without parsing them.
+            return false;
+        }
+    }
+
+    return layout.vertexStride > 0 && layout.faceCountType != tinyply::Type::INVALID;
+}
+
+static PLYHeader parseMappedHeader(const MappedFile &file, const std::string &path, size_t &dataOffset) {
+    static const std::string endKeyword = "end_header";
+
+    auto begin = reinterpret_cast<const char *>(file.getData());
+    auto end = begin + file.getSize();
+
+    // The header ends at the first line whose keyword is end_header. (Comments may mention it, too)
+    for (auto lineBegin = begin; lineBegin < end;) {
+        auto lineEnd = std::find(lineBegin, end, '\n');
+
+        if (lineEnd == end) {
+            break;
+        }
+
+        auto keywordBegin = std::find_if(lineBegin, lineEnd, [](char c) {
+            return c != ' ' && c != '\t';
+        });
+        auto keywordEnd = std::find_if(keywordBegin, lineEnd, [](char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        });
+
+        if (std::string(keywordBegin, keywordEnd) == endKeyword) {
+            std::istringstream in(std::string(begin, lineEnd + 1));
+            dataOffset = static_cast<size_t>(lineEnd + 1 - begin);
+
+            return parseHeader(in, path);
+        }
+
+        lineBegin = lineEnd + 1;
+    }
+
+    throw std::runtime_error("Incomplete PLY header: " + path);
+}
+
+static size_t getFaceStride(const PLYLayout &layout) {
+    return layout.facePrefixSize + getTypeSize(layout.faceCountType) + sizeof(Object::Face) + layout.faceSuffixSize;
+}
+
+static const PLYElement *findElement(const PLYHeader &header, const std::string &name) {
+    for (auto &element : header.elements) {
+        if (element.name == name) {
+            return &element;
+        }
+    }
+
+    return nullptr;
+}
+
+static size_t readListCount(const unsigned char *data, tinyply::Type type) {
+    switch (type) {
+        case tinyply::Type::INT8:
+        case tinyply::Type::UINT8:
+            return data[0];
+        case tinyply::Type::INT16:
+        case tinyply::Type::UINT16: {
+            uint16_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+        default: {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+    }
+}
+
+static void readVertices(
+        const unsigned char *data,
+        const PLYLayout &layout,
+        Object::Mesh &mesh
+) {
+    tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, mesh.vertexCount, chunkRecordCount),
+            [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    auto record = data + i * layout.vertexStride;
+                    auto &vertex = mesh.vertices[i];
+
+                    std::memcpy(&vertex.x, record + layout.positionOffsets[0], sizeof(float));
+                    std::memcpy(&vertex.y, record + layout.positionOffsets[1], sizeof(float));
+                    std::memcpy(&vertex.z, record + layout.positionOffsets[2], sizeof(float));
+                }
+            }
+    );
+}
+
+static void readFaces(
+        const unsigned char *data,
+        const PLYLayout &layout,
+        Object::Mesh &mesh,
+        const std::string &path
+) {
+    size_t indicesOffset = layout.facePrefixSize + getTypeSize(layout.faceCountType);
+    size_t stride = getFaceStride(layout);
+
+    tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, mesh.faceCount, chunkRecordCount),
+            [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i < range.end(); i++) {
+                    auto record = data + i * stride;
+
+                    if (readListCount(record + layout.facePrefixSize, layout.faceCountType) != 3) {
+                        throw std::runtime_error("Only triangles are supported: " + path);
+                    }
+
+                    std::memcpy(&mesh.faces[i], record + indicesOffset, sizeof(Object::Face));
+                }
+            }
+    );
+}
+
+static Object::Mesh readBinaryPLY(
+        const std::shared_ptr<MappedFile> &file,
+        size_t dataOffset,
+        const PLYHeader &header,
+        const PLYLayout &layout,
+        const std::string &path
+) {
+    size_t vertexCount = findElement(header, "vertex")->count;
+    size_t faceCount = findElement(header, "face")->count;
+    size_t vertexOffset = 0;
+    size_t faceOffset = 0;
+    size_t offset = dataOffset;
+
+    for (auto &element : header.elements) {
+        if (element.name == "vertex") {
+            vertexOffset = offset;
+            offset += element.count * layout.vertexStride;
+        } else if (element.name == "face") {
+            faceOffset = offset;
+            offset += element.count * getFaceStride(layout);
+        } else {
+            offset += element.count * getFixedSize(element);
+        }
+    }
+
+    if (offset > file->getSize()) {
+        throw std::runtime_error("Unexpected end of PLY file: " + path);
+    }
+
+    bool isPacked = layout.vertexStride == sizeof(Object::Vertex)
+                    && layout.positionOffsets[0] == 0
+                    && layout.positionOffsets[1] == 4
+                    && layout.positionOffsets[2] == 8;
+
+    bool canShareVertices = isPacked
+                            && vertexOffset % alignof(float) == 0
+                            && vertexOffset + vertexCount * sizeof(Object::Vertex) + Object::Mesh::vertexPadding
+                               <= file->getSize();
+
+    Object::Mesh mesh;
+
+    if (canShareVertices) {
+        // Same layout as Object::Vertex: use the vertices right where they are in the mapped file.
+        auto faces = Object::Mesh::allocate(0, faceCount);
+        auto storage = std::make_shared<MappedStorage>();
+
+        storage->file = file;
+        storage->faces = faces.storage;
+
+        mesh = faces;
+        mesh.storage = storage;
+        mesh.vertices = reinterpret_cast<Object::Vertex *>(file->getData() + vertexOffset);
+        mesh.vertexCount = vertexCount;
+    } else {
+        mesh = Object::Mesh::allocate(vertexCount, faceCount);
+        readVertices(file->getData() + vertexOffset, layout, mesh);
+    }
+
+    readFaces(file->getData() + faceOffset, layout, mesh, path);
+
+    return mesh;
+}
+
+template<typename T>
+static void convertValues(const unsigned char *source, size_t count, T *destination) {
+    std::memcpy(destination, source, count * sizeof(T));
+}
+
+template<typename From, typename To>
+static void convertValues(const unsigned char *source, size_t count, To *destination) {
+    for (size_t i = 0; i < count; i++) {
+        From value;
+        std::memcpy(&value, source + i * sizeof(From), sizeof(From));
+        destination[i] = static_cast<To>(value);
+    }
+}
+
+static Object::Mesh readPLYWithTinyply(std::istream &in) {
+    tinyply::PlyFile file;
+
+    file.parse_header(in);
+    auto vertices = file.request_properties_from_element("vertex", {"x", "y", "z"});
+    auto faces = file.request_properties_from_element("face", {"vertex_indices"}, 3);
+    file.read(in);
+
+    auto mesh = Object::Mesh::allocate(vertices->count, faces->count);
+    auto vertexData = vertices->buffer.get();
+    auto faceData = faces->buffer.get();
+    auto vertexValues = &mesh.vertices[0].x;
+    auto faceValues = &mesh.faces[0].x;
+
+    if (vertices->t == tinyply::Type::FLOAT64) {
+        convertValues<double>(vertexData, mesh.vertexCount * 3, vertexValues);
+    } else {
+        convertValues(vertexData, mesh.vertexCount * 3, vertexValues);
+    }
+
+    switch (faces->t) {
+        case tinyply::Type::INT16:
+        case tinyply::Type::UINT16:
+            convertValues<uint16_t>(faceData, mesh.faceCount * 3, faceValues);
+            break;
+        case tinyply::Type::INT8:
+        case tinyply::Type::UINT8:
+            convertValues<uint8_t>(faceData, mesh.faceCount * 3, faceValues);
+            break;
+        default:
+            convertValues(faceData, mesh.faceCount * 3, faceValues);
+            break;
+    }
+
+    return mesh;
+}
+
+Object::Mesh readPLY(const std::string &path) {
+    std::shared_ptr<MappedFile> file;
+    PLYHeader header;
+    size_t dataOffset = 0;
+    bool isMapped = false;
+
+    // Files the mapped path can't read go to tinyply, which reads them or reports why not.
+    try {
+        file = std::make_shared<MappedFile>(path);
+        header = parseMappedHeader(*file, path, dataOffset);
+        isMapped = true;
+    } catch (const std::exception &) {
+    }
+
+    PLYLayout layout;
+
+    if (isMapped && findBinaryLayout(header, layout)) {
+        return readBinaryPLY(file, dataOffset, header, layout, path);
+    }
+
+    std::ifstream in(path, std::ios::binary);
+
+    if (in.fail()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    return readPLYWithTinyply(in);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+
+#include "Object.hpp"
+
+// Reads the triangles of a PLY file into a new mesh.
+// Binary little-endian files are memory-mapped and used in place or converted in one pass. Other files go through tinyply.
+Object::Mesh readPLY(const std::string &path);
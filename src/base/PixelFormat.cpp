@@ -0,0 +1,199 @@
+#include "PixelFormat.hpp"
+
+#include <glm/gtc/packing.hpp>
+#include <emmintrin.h>
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+static __m128 clampUnit(__m128 value) {
+    return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+// Linear to sRGB for 4 channels in 0 ~ 1, with the curve approximated by square roots.
+// Off by up to 0.73 / 255, so the rounded bytes still need correctByte().
+static __m128 encodeSRGB(__m128 x) {
+    auto s1 = _mm_sqrt_ps(x);
+    auto s2 = _mm_sqrt_ps(s1);
+    auto s3 = _mm_sqrt_ps(s2);
+
+    auto curve = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_set1_ps(0.662002687f), s1), _mm_mul_ps(_mm_set1_ps(0.684122060f), s2)),
+            _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(-0.323583601f), s3), _mm_mul_ps(_mm_set1_ps(0.0225411470f), x))
+    );
+
+    auto line = _mm_mul_ps(x, _mm_set1_ps(12.92f));
+    auto isLinear = _mm_cmple_ps(x, _mm_set1_ps(0.0031308f));
+
+    return _mm_or_ps(_mm_and_ps(isLinear, line), _mm_andnot_ps(isLinear, curve));
+}
+
+static float decodeSRGB(float value) {
+    return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// Linear values where the exactly rounded sRGB byte goes from k to k + 1.
+static const std::array<float, 255> &getSRGBThresholds() {
+    static const std::array<float, 255> thresholds = []() {
+        std::array<float, 255> result;
+
+        for (size_t k = 0; k < result.size(); k++) {
+            auto value = (static_cast<double>(k) + 0.5) / 255.0;
+            auto threshold = (value <= 0.04045) ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+
+            // The smallest float at or above the threshold, so comparisons of floats match the exact curve.
+            result[k] = static_cast<float>(threshold);
+
+            if (result[k] < threshold) {
+                result[k] = std::nextafter(result[k], 1.0f);
+            }
+        }
+
+        return result;
+    }();
+
+    return thresholds;
+}
+
+// Moves a byte rounded from the approximate curve to the one the exact curve rounds to.
+// The approximation is within one step, so one comparison each way is enough.
+static unsigned char correctByte(unsigned char byte, float linear, const std::array<float, 255> &thresholds) {
+    if (byte < 255 && linear >= thresholds[byte]) {
+        byte++;
+    } else if (byte > 0 && linear < thresholds[byte - 1]) {
+        byte--;
+    }
+
+    assert((byte == 255 || linear < thresholds[byte]) && (byte == 0 || linear >= thresholds[byte - 1]));
+
+    return byte;
+}
+
+PixelFormat parsePixelFormat(const std::string &name) {
+    for (auto format : getPixelFormats()) {
+        if (getPixelFormatName(format) == name) {
+            return format;
+        }
+    }
+
+    throw std::runtime_error("Unknown pixel format: " + name);
+}
+
+std::string getPixelFormatName(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGBA16F:
+            return "rgba16f";
+        case PixelFormat::RGB10A2:
+            return "rgb10a2";
+        case PixelFormat::RGBA8SRGB:
+            return "rgba8-srgb";
+        default:
+            return "rgba32f";
+    }
+}
+
+const std::vector<PixelFormat> &getPixelFormats() {
+    static const std::vector<PixelFormat> formats = {
+            PixelFormat::RGBA32F,
+            PixelFormat::RGBA16F,
+            PixelFormat::RGB10A2,
+            PixelFormat::RGBA8SRGB
+    };
+
+    return formats;
+}
+
+size_t getPixelSize(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGBA16F:
+            return 8;
+        case PixelFormat::RGB10A2:
+        case PixelFormat::RGBA8SRGB:
+            return 4;
+        default:
+            return 16;
+    }
+}
+
+void encodePixels(PixelFormat format, const glm::vec3 *colors, size_t count, unsigned char *pixels) {
+    switch (format) {
+        case PixelFormat::RGBA32F:
+            for (size_t i = 0; i < count; i++) {
+                auto pixel = glm::vec4(colors[i], 1.0f);
+                std::memcpy(pixels + i * 16, &pixel, 16);
+            }
+
+            break;
+        case PixelFormat::RGBA16F:
+            for (size_t i = 0; i < count; i++) {
+                auto pixel = glm::packHalf4x16(glm::vec4(colors[i], 1.0f));
+                std::memcpy(pixels + i * 8, &pixel, 8);
+            }
+
+            break;
+        case PixelFormat::RGB10A2:
+            for (size_t i = 0; i < count; i++) {
+                auto pixel = glm::packUnorm3x10_1x2(glm::vec4(colors[i], 1.0f));
+                std::memcpy(pixels + i * 4, &pixel, 4);
+            }
+
+            break;
+        case PixelFormat::RGBA8SRGB: {
+            auto &thresholds = getSRGBThresholds();
+
+            for (size_t i = 0; i < count; i++) {
+                auto &color = colors[i];
+
+                // Alpha goes through the curve too, but 1 stays 1.
+                auto linear = clampUnit(_mm_set_ps(1.0f, color.b, color.g, color.r));
+                auto value = encodeSRGB(linear);
+                auto bytes = _mm_cvtps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+
+                bytes = _mm_packs_epi32(bytes, bytes);
+                bytes = _mm_packus_epi16(bytes, bytes);
+
+                alignas(16) float channels[4];
+                _mm_store_ps(channels, linear);
+
+                auto pixel = pixels + i * 4;
+                auto packed = _mm_cvtsi128_si32(bytes);
+                std::memcpy(pixel, &packed, 4);
+
+                for (int c = 0; c < 3; c++) {
+                    pixel[c] = correctByte(pixel[c], channels[c], thresholds);
+                }
+            }
+
+            break;
+        }
+    }
+}
+
+glm::vec3 decodePixel(PixelFormat format, const unsigned char *pixel) {
+    switch (format) {
+        case PixelFormat::RGBA16F: {
+            glm::uint64 value;
+            std::memcpy(&value, pixel, 8);
+            return glm::vec3(glm::unpackHalf4x16(value));
+        }
+        case PixelFormat::RGB10A2: {
+            glm::uint32 value;
+            std::memcpy(&value, pixel, 4);
+            return glm::vec3(glm::unpackUnorm3x10_1x2(value));
+        }
+        case PixelFormat::RGBA8SRGB:
+            return {
+                    decodeSRGB(static_cast<float>(pixel[0]) / 255.0f),
+                    decodeSRGB(static_cast<float>(pixel[1]) / 255.0f),
+                    decodeSRGB(static_cast<float>(pixel[2]) / 255.0f)
+            };
+        default: {
+            glm::vec3 value;
+            std::memcpy(&value, pixel, 12);
+            return value;
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Layout of the rendered pixels, as uploaded to OpenGL. Alpha is always opaque.
+enum class PixelFormat {
+    RGBA32F,
+    RGBA16F,
+    RGB10A2,
+    RGBA8SRGB
+};
+
+PixelFormat parsePixelFormat(const std::string &name);
+std::string getPixelFormatName(PixelFormat format);
+const std::vector<PixelFormat> &getPixelFormats();
+
+// Bytes per pixel.
+size_t getPixelSize(PixelFormat format);
+
+// Converts linear colors into consecutive pixels of the format.
+void encodePixels(PixelFormat format, const glm::vec3 *colors, size_t count, unsigned char *pixels);
+
+// Reads one pixel back as a linear color.
+glm::vec3 decodePixel(PixelFormat format, const unsigned char *pixel);
@@ -0,0 +1,29 @@
+#pragma once
+
+// Ray counters of a frame.
+// Aligned to a cache line so that per-thread copies never share one.
+struct alignas(64) RayStats {
+    long long primaryRays = 0;
+    long long shadowRays = 0;
+    long long reflectionRays = 0;
+    long long hits = 0;
+    long long misses = 0;
+
+    // Pixels that reused the last frame's color instead of being shaded.
+    long long reprojectedPixels = 0;
+
+    long long getRayCount() const {
+        return primaryRays + shadowRays + reflectionRays;
+    }
+
+    RayStats &operator+=(const RayStats &other) {
+        primaryRays += other.primaryRays;
+        shadowRays += other.shadowRays;
+        reflectionRays += other.reflectionRays;
+        hits += other.hits;
+        misses += other.misses;
+        reprojectedPixels += other.reprojectedPixels;
+
+        return *this;
+    }
+};
@@ -0,0 +1,149 @@
+#include "RenderArena.hpp"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+
+#include <windows.h>
+#elif defined(__linux__)
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
+
+static int parseCPU(const std::string &text) {
+    try {
+        size_t length = 0;
+        int cpu = std::stoi(text, &length);
+
+        if (length == text.size() && cpu >= 0) {
+            return cpu;
+        }
+    } catch (const std::exception &) {
+    }
+
+    throw std::runtime_error("Invalid CPU: " + text);
+}
+
+// Affinity a thread had before it joined the arena.
+struct SavedAffinity {
+    bool isSaved = false;
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+#endif
+};
+
+// TBB threads move between arenas, so each one restores its own affinity when it leaves.
+static thread_local SavedAffinity savedAffinity;
+
+static void pinCurrentThread(int cpu) {
+#ifdef _WIN32
+    auto previous = SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu);
+
+    if (previous != 0 && !savedAffinity.isSaved) {
+        savedAffinity.mask = previous;
+        savedAffinity.isSaved = true;
+    }
+#elif defined(__linux__)
+    if (!savedAffinity.isSaved) {
+        savedAffinity.isSaved =
+                pthread_getaffinity_np(pthread_self(), sizeof(savedAffinity.set), &savedAffinity.set) == 0;
+    }
+
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    // No thread affinity API (e.g. macOS): the threads stay unpinned.
+    (void) cpu;
+#endif
+}
+
+static void restoreCurrentThread() {
+    if (!savedAffinity.isSaved) {
+        return;
+    }
+
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), savedAffinity.mask);
+#elif defined(__linux__)
+    pthread_setaffinity_np(pthread_self(), sizeof(savedAffinity.set), &savedAffinity.set);
+#endif
+
+    savedAffinity.isSaved = false;
+}
+
+RenderArena::PinningObserver::PinningObserver(tbb::task_arena &arena, const std::vector<int> &cpus)
+        : tbb::task_scheduler_observer(arena), m_cpus(cpus) {
+    observe(true);
+}
+
+void RenderArena::PinningObserver::on_scheduler_entry(bool) {
+    // The thread calling execute() takes slot 0 and the workers the others, so every listed CPU gets a thread.
+    auto slot = static_cast<size_t>(tbb::this_task_arena::current_thread_index());
+    pinCurrentThread(m_cpus[slot % m_cpus.size()]);
+}
+
+void RenderArena::PinningObserver::on_scheduler_exit(bool) {
+    restoreCurrentThread();
+}
+
+RenderArena::RenderArena(int concurrency, const std::vector<int> &cpus)
+        : m_arena((concurrency > 0) ? concurrency : tbb::task_arena::automatic) {
+    if (!cpus.empty()) {
+        m_observer.reset(new PinningObserver(m_arena, cpus));
+    }
+}
+
+RenderArena::~RenderArena() {
+    if (m_observer != nullptr) {
+        m_observer->observe(false);
+    }
+}
+
+std::vector<int> RenderArena::parseCPUs(const std::string &text) {
+    std::vector<int> cpus;
+    size_t start = 0;
+
+    while (start < text.size()) {
+        auto end = text.find(',', start);
+
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+
+        auto item = text.substr(start, end - start);
+        auto dash = item.find('-');
+
+        if (dash == std::string::npos) {
+            cpus.push_back(parseCPU(item));
+        } else {
+            int first = parseCPU(item.substr(0, dash));
+            int last = parseCPU(item.substr(dash + 1));
+
+            if (first > last) {
+                throw std::runtime_error("Invalid CPU range: " + item);
+            }
+
+            for (int cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(cpu);
+            }
+        }
+
+        start = end + 1;
+    }
+
+    return cpus;
+}
+
+int RenderArena::getConcurrency() {
+    return m_arena.max_concurrency();
+}
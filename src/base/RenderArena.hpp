@@ -0,0 +1,46 @@
+#pragma once
+
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_observer.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// TBB arena the frames are rendered in. Bounds the render threads, and optionally pins them to CPUs.
+class RenderArena {
+public:
+    // Zero or less concurrency means TBB's default.
+    RenderArena(int concurrency, const std::vector<int> &cpus);
+    ~RenderArena();
+
+    RenderArena(const RenderArena &) = delete;
+    RenderArena &operator=(const RenderArena &) = delete;
+
+    // Parses a list like "0-3,8".
+    static std::vector<int> parseCPUs(const std::string &text);
+
+    int getConcurrency();
+
+    template<typename Function>
+    void execute(const Function &function) {
+        m_arena.execute(function);
+    }
+
+private:
+    // Pins each thread that joins the arena to one of the CPUs, by its slot in the arena,
+    // and gives it back its previous affinity when it leaves.
+    class PinningObserver : public tbb::task_scheduler_observer {
+    public:
+        PinningObserver(tbb::task_arena &arena, const std::vector<int> &cpus);
+
+        void on_scheduler_entry(bool isWorker) override;
+        void on_scheduler_exit(bool isWorker) override;
+
+    private:
+        std::vector<int> m_cpus;
+    };
+
+    tbb::task_arena m_arena;
+    std::unique_ptr<PinningObserver> m_observer;
+};
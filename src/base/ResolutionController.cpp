@@ -0,0 +1,63 @@
+#include "ResolutionController.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Frame time band around the target, inside which the scale is kept.
+static const float upperBand = 1.1f;
+static const float lowerBand = 0.8f;
+
+// Largest relative increase of the scale in one step. (Decreases aren't limited, to recover quickly)
+static const float maxGrowth = 1.1f;
+
+// Scales are rounded to this, so small changes don't reallocate the frame.
+static const float scaleStep = 1.0f / 32.0f;
+
+static const int cooldownFrames = 10;
+
+ResolutionController::ResolutionController(float targetFrameTime, float minScale, float maxScale)
+        : m_targetFrameTime(targetFrameTime),
+          m_minScale((std::min)(minScale, maxScale)),
+          m_maxScale(maxScale),
+          m_scale(maxScale) {}
+
+void ResolutionController::update(float frameTime) {
+    if (m_targetFrameTime <= 0.0f || frameTime <= 0.0f) {
+        return;
+    }
+
+    // The first frame, or the first one right after a change, shows the new cost.
+    m_smoothFrameTime = (m_cooldown == cooldownFrames || m_smoothFrameTime <= 0.0f)
+                        ? frameTime
+                        : m_smoothFrameTime * 0.8f + frameTime * 0.2f;
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return;
+    }
+
+    auto ratio = m_smoothFrameTime / m_targetFrameTime;
+
+    if (ratio < upperBand && ratio > lowerBand) {
+        return;
+    }
+
+    // The render time follows the pixel count, which is the square of the scale.
+    auto scale = m_scale * (std::min)(std::sqrt(1.0f / ratio), maxGrowth);
+
+    scale = std::round(scale / scaleStep) * scaleStep;
+    scale = (std::min)((std::max)(scale, m_minScale), m_maxScale);
+
+    if (scale != m_scale) {
+        m_scale = scale;
+        m_cooldown = cooldownFrames;
+    }
+}
+
+float ResolutionController::getScale() const {
+    return m_scale;
+}
+
+glm::ivec2 ResolutionController::getSize(const glm::ivec2 &viewSize) const {
+    return glm::max(glm::ivec2(glm::round(glm::vec2(viewSize) * m_scale)), glm::ivec2(1));
+}
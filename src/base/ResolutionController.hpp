@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Scales the render resolution to keep the render time of a frame near a target.
+// The scale is the ratio of the render size to the view size, on each axis.
+class ResolutionController {
+public:
+    // A target of zero or less keeps the scale at maxScale.
+    ResolutionController(float targetFrameTime, float minScale, float maxScale);
+
+    // Render time of a frame at the current scale, in seconds.
+    void update(float frameTime);
+
+    float getScale() const;
+    glm::ivec2 getSize(const glm::ivec2 &viewSize) const;
+
+private:
+    float m_targetFrameTime;
+    float m_minScale;
+    float m_maxScale;
+    float m_scale;
+    float m_smoothFrameTime = 0.0f;
+
+    // Frames to wait before the next change, so a change is measured before acting again.
+    int m_cooldown = 0;
+};
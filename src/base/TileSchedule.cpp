@@ -0,0 +1,171 @@
+#include "TileSchedule.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+// Tile sizes chooseTileSize() picks from, and the tiles each thread should get at least.
+static const int tileSizes[] = {32, 16, 8, 4};
+static const int minTilesPerThread = 64;
+
+// Position of the index on a Morton (Z-order) curve: x and y are the even and odd bits.
+static glm::ivec2 getMortonPosition(int index) {
+    glm::ivec2 position(0);
+
+    for (int bit = 0; (index >> (bit * 2)) != 0; bit++) {
+        position.x |= ((index >> (bit * 2)) & 1) << bit;
+        position.y |= ((index >> (bit * 2 + 1)) & 1) << bit;
+    }
+
+    return position;
+}
+
+// Position of the index on a Hilbert curve filling a side x side square. (side: power of 2)
+static glm::ivec2 getHilbertPosition(int index, int side) {
+    glm::ivec2 position(0);
+
+    for (int scale = 1; scale < side; scale *= 2) {
+        int rx = 1 & (index / 2);
+        int ry = 1 & (index ^ rx);
+
+        // Rotate the quadrant.
+        if (ry == 0) {
+            if (rx == 1) {
+                position = glm::ivec2(scale - 1) - position;
+            }
+
+            std::swap(position.x, position.y);
+        }
+
+        position += glm::ivec2(scale * rx, scale * ry);
+        index /= 4;
+    }
+
+    return position;
+}
+
+TileOrder parseTileOrder(const std::string &name) {
+    for (auto order : getTileOrders()) {
+        if (getTileOrderName(order) == name) {
+            return order;
+        }
+    }
+
+    throw std::runtime_error("Unknown tile order: " + name);
+}
+
+std::string getTileOrderName(TileOrder order) {
+    switch (order) {
+        case TileOrder::Morton:
+            return "morton";
+        case TileOrder::Hilbert:
+            return "hilbert";
+        default:
+            return "row-major";
+    }
+}
+
+const std::vector<TileOrder> &getTileOrders() {
+    static const std::vector<TileOrder> orders = {
+            TileOrder::RowMajor,
+            TileOrder::Morton,
+            TileOrder::Hilbert
+    };
+
+    return orders;
+}
+
+TilePartitioner parseTilePartitioner(const std::string &name) {
+    for (auto partitioner : getTilePartitioners()) {
+        if (getTilePartitionerName(partitioner) == name) {
+            return partitioner;
+        }
+    }
+
+    throw std::runtime_error("Unknown partitioner: " + name);
+}
+
+std::string getTilePartitionerName(TilePartitioner partitioner) {
+    switch (partitioner) {
+        case TilePartitioner::Affinity:
+            return "affinity";
+        case TilePartitioner::Static:
+            return "static";
+        case TilePartitioner::Simple:
+            return "simple";
+        default:
+            return "auto";
+    }
+}
+
+const std::vector<TilePartitioner> &getTilePartitioners() {
+    static const std::vector<TilePartitioner> partitioners = {
+            TilePartitioner::Auto,
+            TilePartitioner::Affinity,
+            TilePartitioner::Static,
+            TilePartitioner::Simple
+    };
+
+    return partitioners;
+}
+
+std::vector<int> createTileOrder(TileOrder order, int numTilesX, int numTilesY) {
+    std::vector<int> indices;
+    indices.reserve(static_cast<size_t>(numTilesX * numTilesY));
+
+    if (order == TileOrder::RowMajor) {
+        for (int i = 0; i < numTilesX * numTilesY; i++) {
+            indices.push_back(i);
+        }
+
+        return indices;
+    }
+
+    // The curves fill a power of 2 square. Tiles outside the grid are skipped.
+    int side = 1;
+
+    while (side < numTilesX || side < numTilesY) {
+        side *= 2;
+    }
+
+    for (int i = 0; i < side * side; i++) {
+        auto position = (order == TileOrder::Morton) ? getMortonPosition(i) : getHilbertPosition(i, side);
+
+        if (position.x < numTilesX && position.y < numTilesY) {
+            indices.push_back(position.y * numTilesX + position.x);
+        }
+    }
+
+    return indices;
+}
+
+int chooseTileSize(const glm::ivec2 &size, int threadCount) {
+    for (auto tileSize : tileSizes) {
+        int numTilesX = (size.x + tileSize - 1) / tileSize;
+        int numTilesY = (size.y + tileSize - 1) / tileSize;
+
+        if (numTilesX * numTilesY >= minTilesPerThread * threadCount) {
+            return tileSize;
+        }
+    }
+
+    return 4;
+}
+
+std::string getTileScheduleOptions(const TileSchedule &schedule) {
+    std::stringstream ss;
+
+    ss << "--tile-size=";
+
+    if (schedule.tileSize > 0) {
+        ss << schedule.tileSize;
+    } else {
+        ss << "auto";
+    }
+
+    ss << " --tile-order=" << getTileOrderName(schedule.order)
+       << " --partitioner=" << getTilePartitionerName(schedule.partitioner)
+       << " --grain-size=" << schedule.grainSize;
+
+    return ss.str();
+}
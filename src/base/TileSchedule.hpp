@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+// Order tiles are handed out in. Space-filling curves keep nearby tiles (and their BVH nodes) close in time.
+enum class TileOrder {
+    RowMajor,
+    Morton,
+    Hilbert
+};
+
+// TBB partitioner splitting the tiles among the threads.
+enum class TilePartitioner {
+    Auto,
+    Affinity,
+    Static,
+    Simple
+};
+
+// How frames are cut into tiles, and the tiles handed to the threads.
+struct TileSchedule {
+    // In pixels, a multiple of 4. (The packet width) Zero picks it from the frame size and the threads.
+    int tileSize = 8;
+    TileOrder order = TileOrder::RowMajor;
+    TilePartitioner partitioner = TilePartitioner::Auto;
+
+    // Tiles per task: the least for Auto, exactly for Simple.
+    int grainSize = 1;
+};
+
+TileOrder parseTileOrder(const std::string &name);
+std::string getTileOrderName(TileOrder order);
+const std::vector<TileOrder> &getTileOrders();
+
+TilePartitioner parseTilePartitioner(const std::string &name);
+std::string getTilePartitionerName(TilePartitioner partitioner);
+const std::vector<TilePartitioner> &getTilePartitioners();
+
+// Row-major indices of the tiles of a grid, in the order.
+std::vector<int> createTileOrder(TileOrder order, int numTilesX, int numTilesY);
+
+// Largest tile size still giving every thread plenty of tiles to balance.
+int chooseTileSize(const glm::ivec2 &size, int threadCount);
+
+// The schedule as options. (e.g. "--tile-size=16 --tile-order=hilbert ...")
+std::string getTileScheduleOptions(const TileSchedule &schedule);
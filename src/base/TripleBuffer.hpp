@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+
+// Lock-free triple buffer for one writer and one reader.
+// The writer fills the back buffer and publishes it, the reader fetches the latest published one.
+// Neither side ever waits for the other: an unread frame is simply replaced by a newer one.
+template<typename T>
+class TripleBuffer {
+public:
+    T &getWriteBuffer() {
+        return m_buffers[m_back];
+    }
+
+    // Makes the write buffer the latest frame, and takes the old middle buffer for the next write.
+    void publish() {
+        m_back = m_middle.exchange(m_back | freshFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Takes the latest frame if one was published since the last fetch. Returns whether it did.
+    bool fetch() {
+        if ((m_middle.load(std::memory_order_relaxed) & freshFlag) == 0) {
+            return false;
+        }
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T &getReadBuffer() const {
+        return m_buffers[m_front];
+    }
+
+private:
+    static const int indexMask = 3;
+    static const int freshFlag = 4;
+
+    T m_buffers[3];
+    int m_back = 0;
+    std::atomic<int> m_middle{1};
+    int m_front = 2;
+};
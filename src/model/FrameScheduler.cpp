@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "FrameScheduler.hpp"
+
+// Frames the statistics are computed over.
+static const int frameTimeCount = 240;
+
+// Without a presented frame for this long, tick at the idle rate.
+static const std::chrono::milliseconds idleDelay(500);
+static const std::chrono::milliseconds idleInterval(100);
+
+static float computeDurationInSeconds(
+        const std::chrono::steady_clock::time_point &startTime,
+        const std::chrono::steady_clock::time_point &endTime
+) {
+    return std::chrono::duration_cast<std::chrono::duration<float>>(endTime - startTime).count();
+}
+
+FrameScheduler::FrameScheduler(float targetFPS, QObject *parent)
+        : QObject(parent),
+          m_interval(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(1.0f / targetFPS))) {
+    m_frameTimes.reserve(frameTimeCount);
+
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+
+    connect(m_timer, &QTimer::timeout, this, &FrameScheduler::tick);
+
+    m_deadline = Clock::now();
+    schedule(m_deadline);
+}
+
+void FrameScheduler::presented() {
+    auto now = Clock::now();
+
+    if (m_hasPresented) {
+        auto frameTime = computeDurationInSeconds(m_lastPresentTime, now);
+
+        if (m_frameTimes.size() < frameTimeCount) {
+            m_frameTimes.push_back(frameTime);
+        } else {
+            m_frameTimes[m_frameTimeIndex] = frameTime;
+        }
+
+        m_frameTimeIndex = (m_frameTimeIndex + 1) % frameTimeCount;
+    }
+
+    m_lastPresentTime = now;
+    m_hasPresented = true;
+
+    // Lock the phase to the actual presentation (e.g. vsync), instead of drifting against it.
+    m_deadline = now + m_interval;
+    schedule(m_deadline);
+}
+
+bool FrameScheduler::isIdle() const {
+    return !m_hasPresented || Clock::now() - m_lastPresentTime > idleDelay;
+}
+
+float FrameScheduler::getFPS() const {
+    if (m_frameTimes.isEmpty() || isIdle()) {
+        return 0.0f;
+    }
+
+    float sum = 0.0f;
+
+    for (auto frameTime : m_frameTimes) {
+        sum += frameTime;
+    }
+
+    return static_cast<float>(m_frameTimes.size()) / sum;
+}
+
+float FrameScheduler::getFrameTimePercentile(float percentile) const {
+    if (m_frameTimes.isEmpty()) {
+        return 0.0f;
+    }
+
+    auto frameTimes = m_frameTimes;
+    auto index = static_cast<int>(percentile * static_cast<float>(frameTimes.size() - 1) + 0.5f);
+
+    std::nth_element(frameTimes.begin(), frameTimes.begin() + index, frameTimes.end());
+
+    return frameTimes[index] * 1000.0f;
+}
+
+void FrameScheduler::tick() {
+    emit ticked();
+
+    // Drift-free: advance from the previous deadline, but don't try to catch up on missed ticks.
+    auto now = Clock::now();
+    auto interval = isIdle() ? std::chrono::duration_cast<Clock::duration>(idleInterval) : m_interval;
+
+    m_deadline = (std::max)(m_deadline + interval, now);
+    schedule(m_deadline);
+}
+
+void FrameScheduler::schedule(Clock::time_point deadline) {
+    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+
+    m_timer->start(static_cast<int>((std::max)(static_cast<long long>(delay.count()), 0LL)));
+}
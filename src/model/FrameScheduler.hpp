@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+#include <chrono>
+
+// Paces the GUI: ticks at the target rate with a precise timer, locked to the presented frames.
+// Without new frames for a while, it ticks slowly until frames come again.
+class FrameScheduler : public QObject {
+Q_OBJECT
+
+public:
+    explicit FrameScheduler(float targetFPS, QObject *parent = nullptr);
+
+    // Call when the frame shown at a tick reached the screen. (e.g. QOpenGLWidget::frameSwapped)
+    void presented();
+
+    bool isIdle() const;
+
+    // Presented frames per second.
+    float getFPS() const;
+
+    // Frame time (ms) below which the given share (0 ~ 1) of the recent frames are.
+    float getFrameTimePercentile(float percentile) const;
+
+signals:
+    void ticked();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void tick();
+    void schedule(Clock::time_point deadline);
+
+    QTimer *m_timer = new QTimer(this);
+    Clock::duration m_interval;
+    Clock::time_point m_deadline;
+    Clock::time_point m_lastPresentTime;
+    bool m_hasPresented = false;
+
+    // Recent present-to-present intervals, in seconds.
+    QVector<float> m_frameTimes;
+    int m_frameTimeIndex = 0;
+};
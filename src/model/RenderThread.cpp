@@ -0,0 +1,121 @@
+#include <xmmintrin.h>
+#include <pmmintrin.h>
+
+#include <chrono>
+#include <iostream>
+
+#include "RenderThread.hpp"
+
+// Width and height in one word, so the render thread never sees half of a resize.
+static unsigned long long packSize(const glm::ivec2 &size) {
+    return (static_cast<unsigned long long>(static_cast<unsigned int>(size.x)) << 32u)
+           | static_cast<unsigned int>(size.y);
+}
+
+// While sleeping, how often to look for changes nobody woke the thread for. (e.g. a finished load)
+static const std::chrono::milliseconds idleCheckInterval(50);
+
+static glm::ivec2 unpackSize(unsigned long long value) {
+    return {static_cast<int>(value >> 32u), static_cast<int>(value & 0xFFFFFFFFu)};
+}
+
+RenderThread::RenderThread(SceneModel &sceneModel)
+        : m_sceneModel(sceneModel) {
+    m_size = packSize(sceneModel.getSize());
+    m_thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+    m_running = false;
+    wake();
+    m_thread.join();
+}
+
+void RenderThread::setSize(const glm::ivec2 &size) {
+    if (m_size.exchange(packSize(size)) != packSize(size)) {
+        wake();
+    }
+}
+
+void RenderThread::wake() {
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wakeCondition.notify_one();
+}
+
+const RenderThread::Frame *RenderThread::fetchFrame() {
+    return m_frames.fetch() ? &m_frames.getReadBuffer() : nullptr;
+}
+
+bool RenderThread::fetchError(std::string &error) {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+
+    if (!m_errorChanged) {
+        return false;
+    }
+
+    error = m_error;
+    m_errorChanged = false;
+
+    return true;
+}
+
+void RenderThread::setError(const std::string &error) {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+
+    if (error != m_error) {
+        m_error = error;
+        m_errorChanged = true;
+    }
+}
+
+void RenderThread::run() {
+    // The control register is per thread, so this thread needs the mode Embree recommends, too.
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+    _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+
+    while (m_running) {
+        auto size = unpackSize(m_size);
+
+        if (size == m_sceneModel.getSize() && !m_sceneModel.isFrameOutdated()) {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCondition.wait_for(lock, idleCheckInterval);
+            continue;
+        }
+
+        try {
+            m_sceneModel.setSize(size);
+            m_sceneModel.render();
+        } catch (const std::exception &error) {
+            std::cout << "Error: " << error.what() << "\n";
+            setError(error.what());
+
+            // Try again after a while, or once something changes.
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeCondition.wait_for(lock, idleCheckInterval);
+            continue;
+        }
+
+        setError("");
+
+        auto &frame = m_frames.getWriteBuffer();
+        auto &governor = m_sceneModel.getGovernor();
+
+        // The frame's old pixels become the next render target, so nothing is copied.
+        m_sceneModel.swapPixels(frame.pixels);
+
+        frame.format = m_sceneModel.getPixelFormat();
+        frame.size = m_sceneModel.getSize();
+        frame.tileFrames = m_sceneModel.getTileFrames();
+        frame.tileSize = m_sceneModel.getTileSize();
+        frame.rayStats = m_sceneModel.getRayStats();
+        frame.rps = m_sceneModel.getRPS();
+        frame.frameTime = governor.getFrameTime();
+        frame.workTime = governor.getWorkTime();
+        frame.headroom = governor.getHeadroom();
+        frame.sampleCount = m_sceneModel.getSampleCount();
+        frame.convergence = m_sceneModel.getConvergence();
+        frame.index = m_sceneModel.getFrameCount() - 1;
+
+        m_frames.publish();
+    }
+}
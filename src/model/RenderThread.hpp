@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../base/RayStats.hpp"
+#include "../base/TripleBuffer.hpp"
+#include "SceneModel.hpp"
+
+// Renders frames on its own thread, publishing each finished one through a triple buffer.
+// While the frames wouldn't change (see SceneModel::isFrameOutdated()), the thread sleeps.
+// A failed frame is reported through fetchError(), and the thread keeps trying.
+class RenderThread {
+public:
+    struct Frame {
+        std::vector<unsigned char> pixels;
+        PixelFormat format = PixelFormat::RGBA32F;
+        glm::ivec2 size = {0, 0};
+        // See SceneModel::getTileFrames().
+        std::vector<long long> tileFrames;
+        int tileSize = 0;
+        RayStats rayStats;
+        float rps = 0.0f;
+        float frameTime = 0.0f;
+        float workTime = 0.0f;
+        float headroom = 0.0f;
+        float sampleCount = 0.0f;
+        float convergence = 0.0f;
+        long long index = -1;
+    };
+
+    explicit RenderThread(SceneModel &sceneModel);
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    // Applies from the next frame.
+    void setSize(const glm::ivec2 &size);
+
+    // Call after changing the scene model, to render again without waiting for the next check.
+    void wake();
+
+    // Latest finished frame, or nullptr if no frame was finished since the last call.
+    // Stays valid until the next call.
+    const Frame *fetchFrame();
+
+    // Message of the last failed frame (empty once frames render again), if it changed since the last call.
+    bool fetchError(std::string &error);
+
+private:
+    void run();
+    void setError(const std::string &error);
+
+    SceneModel &m_sceneModel;
+    TripleBuffer<Frame> m_frames;
+    std::atomic<bool> m_running{true};
+    std::atomic<unsigned long long> m_size{0};
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::mutex m_errorMutex;
+    std::string m_error;
+    bool m_errorChanged = false;
+    std::thread m_thread;
+};
@@ -1,43 +1,23 @@
 #include <tbb/tbb.h>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <stdexcept>
 #include <iostream>
-#include <chrono>
+#include <sstream>
 
 #include "../base/Object.hpp"
 #include "SceneModel.hpp"
 
-#define AT_START(JOB) JOB
-
-#define AT_END(JOB) \
-do { \
-    saveTheWorld(); \
-    JOB \
-} while (m_rps > answerOfOurLife);
-
-typedef std::chrono::time_point<std::chrono::steady_clock> Time;
-
-static const float answerOfOurLife = 24.5f * 1000000.0f;
-
-static void saveTheWorld() {
-    tbb::this_tbb_thread::sleep(tbb::tick_count::interval_t(0.0005));
-}
-
-static Time getTime() {
-    return std::chrono::high_resolution_clock::now();
-}
-
-static float computeDurationInSeconds(const Time &startTime, const Time &endTime) {
-    return std::chrono::duration_cast<std::chrono::duration<float>>(endTime - startTime).count();
-}
-
-static int sumAndClear(std::vector<int> &values) {
-    int result = 0;
+static RayStats sumAndClear(SceneModel::ThreadStats &values) {
+    RayStats result;
 
     for (auto &value : values) {
         result += value;
-        value = 0;
+        value = RayStats();
     }
 
     return result;
@@ -71,19 +51,203 @@ static RTCRayHit createRay(
     return ray;
 }
 
+// Pixel block covered by a ray packet: 4 x 2 pixels for 8 rays, 4 x 4 pixels for 16 rays.
+static const int packetWidth = 4;
+
+static void intersectPacket(const int *valid, RTCScene scene, RTCIntersectContext *context, RTCRayHit8 *rays) {
+    rtcIntersect8(valid, scene, context, rays);
+}
+
+static void intersectPacket(const int *valid, RTCScene scene, RTCIntersectContext *context, RTCRayHit16 *rays) {
+    rtcIntersect16(valid, scene, context, rays);
+}
+
+template<typename RayHitN>
+static void packRays(const RTCRayHit *rays, RayHitN &packet, int count) {
+    for (int i = 0; i < count; i++) {
+        auto &ray = rays[i];
+
+        packet.ray.org_x[i] = ray.ray.org_x;
+        packet.ray.org_y[i] = ray.ray.org_y;
+        packet.ray.org_z[i] = ray.ray.org_z;
+        packet.ray.tnear[i] = ray.ray.tnear;
+
+        packet.ray.dir_x[i] = ray.ray.dir_x;
+        packet.ray.dir_y[i] = ray.ray.dir_y;
+        packet.ray.dir_z[i] = ray.ray.dir_z;
+        packet.ray.time[i] = ray.ray.time;
+
+        packet.ray.tfar[i] = ray.ray.tfar;
+        packet.ray.mask[i] = ray.ray.mask;
+        packet.ray.flags[i] = ray.ray.flags;
+
+        packet.hit.geomID[i] = ray.hit.geomID;
+        packet.hit.primID[i] = ray.hit.primID;
+        packet.hit.instID[0][i] = ray.hit.instID[0];
+    }
+}
+
+template<typename RayHitN>
+static void unpackRays(const RayHitN &packet, RTCRayHit *rays, int count) {
+    for (int i = 0; i < count; i++) {
+        auto &ray = rays[i];
+
+        ray.ray.tfar = packet.ray.tfar[i];
+
+        ray.hit.Ng_x = packet.hit.Ng_x[i];
+        ray.hit.Ng_y = packet.hit.Ng_y[i];
+        ray.hit.Ng_z = packet.hit.Ng_z[i];
+        ray.hit.u = packet.hit.u[i];
+        ray.hit.v = packet.hit.v[i];
+        ray.hit.geomID = packet.hit.geomID[i];
+        ray.hit.primID = packet.hit.primID[i];
+        ray.hit.instID[0] = packet.hit.instID[0][i];
+    }
+}
+
+// FNV-1a over 4-byte words. (Every pixel format is a multiple of 4 bytes)
+static std::uint64_t hashPixels(const unsigned char *pixels, size_t size, std::uint64_t hash) {
+    for (size_t i = 0; i + 4 <= size; i += 4) {
+        std::uint32_t word;
+        std::memcpy(&word, pixels + i, 4);
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// Progressive mode: tiles take this many samples before their error estimate is trusted,
+// and at most this many in one frame.
+static const int minTileSamples = 4;
+static const int maxTileSamplesPerFrame = 4;
+
+// Largest distance between a hit and the one it reuses, relative to the model's size.
+static const float reprojectionTolerance = 0.005f;
+
+static float getLuminance(const glm::vec3 &color) {
+    return (color.r + color.g + color.b) / 3.0f;
+}
+
+// Radical inverse of the index, for sample positions spread evenly in 0 ~ 1.
+static float getHalton(int index, int base) {
+    float result = 0.0f;
+    float fraction = 1.0f;
+
+    while (index > 0) {
+        fraction /= static_cast<float>(base);
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+    }
+
+    return result;
+}
+
 static size_t getThreadIndex() {
     return tbb::this_task_arena::current_thread_index();
 }
 
-static size_t getThreadCount() {
-    return tbb::this_task_arena::max_concurrency();
+// Embree device settings. (See "Embree API > rtcNewDevice" for the keys)
+static std::string createDeviceConfig(const Options &options) {
+    std::stringstream ss;
+
+    ss << "verbose=0";
+
+    if (options.has("threads")) {
+        ss << ",threads=" << options.getInt("threads", 0);
+    }
+
+    if (options.has("isa")) {
+        ss << ",isa=" << options.getString("isa");
+    }
+
+    if (options.getBool("set-affinity", false)) {
+        ss << ",set_affinity=1";
+    }
+
+    if (options.has("frequency-level")) {
+        ss << ",frequency_level=" << options.getString("frequency-level");
+    }
+
+    return ss.str();
 }
 
-SceneModel::SceneModel(QObject *parent) : QObject(parent) {
-    m_device = rtcNewDevice("verbose=0");
+static TileSchedule createTileSchedule(const Options &options) {
+    TileSchedule schedule;
+    auto tileSize = options.getString("tile-size", "8");
+
+    schedule.tileSize = (tileSize == "auto") ? 0 : options.getInt("tile-size", 8);
+    schedule.order = parseTileOrder(options.getString("tile-order", "row-major"));
+    schedule.partitioner = parseTilePartitioner(options.getString("partitioner", "auto"));
+    schedule.grainSize = options.getInt("grain-size", 1);
+
+    return schedule;
+}
+
+// Render threads: as many as the pinned CPUs, or as Embree's threads, unless set.
+static int getRenderConcurrency(const Options &options) {
+    auto cpus = RenderArena::parseCPUs(options.getString("pin-cpus"));
+    auto defaultConcurrency = cpus.empty() ? options.getInt("threads", 0) : static_cast<int>(cpus.size());
+
+    return options.getInt("render-threads", defaultConcurrency);
+}
+
+SceneModel::SceneModel(const Options &options)
+        : m_governor(
+                  FrameGovernor::parsePolicy(options.getString("governor", "uncapped")),
+                  options.getFloat("governor-target", 0.0f)
+          ),
+          m_arena(
+                  getRenderConcurrency(options),
+                  RenderArena::parseCPUs(options.getString("pin-cpus"))
+          ),
+          // Only look for (and create) the default directory if no directory was given.
+          m_meshCache(
+                  options.has("mesh-cache") ? options.getString("mesh-cache") : MeshCache::getDefaultDirectory(),
+                  static_cast<long long>(options.getFloat("mesh-cache-size", 4096.0f) * 1024.0f * 1024.0f)
+          ),
+          m_tileSchedule(createTileSchedule(options)),
+          m_buildProfile(parseBuildProfile(options.getString("build", "balanced"))),
+          m_animating(options.getBool("animate", true)),
+          m_animatingLights(options.getBool("animate-lights", !options.getBool("reproject", false))),
+          m_memoryBudget(static_cast<long long>(options.getFloat("memory-budget", 0.0f) * 1024.0f * 1024.0f)),
+          m_pixelFormat(parsePixelFormat(options.getString("pixel-format", "rgba32f"))),
+          m_progressive(options.getBool("progressive", false)),
+          m_maxSamples((std::max)(options.getInt("max-samples", 256), 1)),
+          m_convergenceThreshold(options.getFloat("convergence", 0.001f)),
+          m_reprojecting(options.getBool("reproject", false)),
+          m_reprojectionAge((std::max)(options.getInt("reproject-age", 4), 1)) {
+    setTileSchedule(m_tileSchedule);
+
+    if (m_reprojecting && m_animatingLights) {
+        std::cout << "Warning: --reproject reuses no pixels while the lights move (--animate-lights=1)\n";
+    }
+
+    m_device = rtcNewDevice(createDeviceConfig(options).c_str());
+
+    // Counts the BVH and other memory Embree allocates. (Shared mesh buffers are counted in createWorld())
+    // Allocations beyond the budget are refused, which makes Embree abort the build with RTC_ERROR_OUT_OF_MEMORY.
+    rtcSetDeviceMemoryMonitorFunction(m_device, [](void *userPtr, ssize_t bytes, bool post) {
+        auto model = static_cast<SceneModel *>(userPtr);
+        auto budget = model->m_memoryBudget;
+
+        if (bytes > 0 && !post && budget > 0 && model->getMemoryUsage() + bytes > budget) {
+            model->m_budgetExceeded = true;
+            return false;
+        }
+
+        model->m_deviceBytes += bytes;
+        return true;
+    }, this);
 
-    rtcSetDeviceErrorFunction(m_device, [](void *, RTCError code, const char *message) {
-        if (code != RTC_ERROR_NONE) {
+    rtcSetDeviceErrorFunction(m_device, [](void *userPtr, RTCError code, const char *message) {
+        auto model = static_cast<SceneModel *>(userPtr);
+
+        // Cancelled builds and refused allocations are expected, and createWorld() checks for them itself.
+        if (code == RTC_ERROR_OUT_OF_MEMORY && model->m_budgetExceeded) {
+            return;
+        }
+
+        if (code != RTC_ERROR_NONE && code != RTC_ERROR_CANCELLED) {
             std::stringstream ss;
 
             ss << "[";
@@ -117,70 +281,232 @@ SceneModel::SceneModel(QObject *parent) : QObject(parent) {
 
             throw std::runtime_error(ss.str());
         }
-    }, nullptr);
+    }, this);
+
+    // Use the widest packet the CPU traces natively. Otherwise, shoot single rays.
+    if (rtcGetDeviceProperty(m_device, RTC_DEVICE_PROPERTY_NATIVE_RAY16_SUPPORTED)) {
+        m_packetSize = 16;
+    } else if (rtcGetDeviceProperty(m_device, RTC_DEVICE_PROPERTY_NATIVE_RAY8_SUPPORTED)) {
+        m_packetSize = 8;
+    }
 
-    m_scene = rtcNewScene(m_device);
-    rtcCommitScene(m_scene);
 }
 
 SceneModel::~SceneModel() {
-    rtcReleaseScene(m_scene);
+    m_frameWorld.reset();
+    m_world.reset();
+
     rtcReleaseDevice(m_device);
 }
 
+SceneModel::World::~World() {
+    if (meshBytesCounter != nullptr) {
+        *meshBytesCounter -= meshBytes;
+    }
+
+    mainObject.reset();
+    roomObject.reset();
+    mirrorObject.reset();
+
+    if (scene != nullptr) {
+        rtcReleaseScene(scene);
+    }
+}
+
 void SceneModel::render() {
-    AT_START(
-            auto startTime = getTime();
-            auto threadCount = getThreadCount();
+    m_governor.startFrame();
 
-            if (m_rayCounts.size() != threadCount) {
-                m_rayCounts = std::vector<int>(threadCount, 0);
-            }
-    );
+    // After swapPixels(), the buffer may be from a frame of another size.
+    m_pixels.resize(static_cast<size_t>(m_size.x * m_size.y) * getPixelSize(m_pixelFormat));
+
+    auto threadCount = static_cast<size_t>(m_arena.getConcurrency());
+
+    if (m_threadStats.size() != threadCount) {
+        m_threadStats = ThreadStats(threadCount);
+        m_rayStreams = std::vector<RayStream>(threadCount);
+    }
+
+    auto world = std::atomic_load(&m_world);
+    bool animating = m_animating;
+    bool worldChanged = (world != m_frameWorld);
+    bool viewChanged = worldChanged || animating;
+    auto previousLights = m_lights;
+
+    // A new model was loaded: restart the animation around it.
+    if (worldChanged) {
+        m_frameWorld = world;
+
+        if (objectsExist()) {
+            updateCamera();
+            updateLights();
+        }
+    }
+
+    auto previousRayShoot = m_rayShoot;
 
     updateRayShoot();
-    animateCamera();
-    animateLights();
-
-    int tileSizeX = 8;
-    int tileSizeY = 8;
-    int numTilesX = (m_size.x + tileSizeX - 1) / tileSizeX;
-    int numTilesY = (m_size.y + tileSizeY - 1) / tileSizeY;
-
-    tbb::parallel_for(tbb::blocked_range<int>(0, numTilesX * numTilesY), [&](const tbb::blocked_range<int> &range) {
-        int threadIndex = static_cast<int>(getThreadIndex());
-
-        for (int taskIndex = range.begin(); taskIndex < range.end(); taskIndex++) {
-            int tileY = taskIndex / numTilesX;
-            int tileX = taskIndex - tileY * numTilesX;
-            int x0 = tileX * tileSizeX;
-            int x1 = (std::min)(x0 + tileSizeX, m_size.x);
-            int y0 = tileY * tileSizeY;
-            int y1 = (std::min)(y0 + tileSizeY, m_size.y);
-
-            for (int y = y0; y < y1; y++) {
-                for (int x = x0; x < x1; x++) {
-                    computePixel(threadIndex, x, y);
-                }
+
+    if (animating) {
+        animateCamera();
+
+        if (m_animatingLights) {
+            animateLights();
+        }
+    }
+
+    auto tileSize = (m_tileSchedule.tileSize > 0)
+                    ? m_tileSchedule.tileSize
+                    : chooseTileSize(m_size, static_cast<int>(threadCount));
+
+    // A new tile size is a new tile layout.
+    if (tileSize != m_tileSize) {
+        m_tileSize = tileSize;
+        m_tileFrames.clear();
+        m_tileSamples.clear();
+    }
+
+    int numTilesX = (m_size.x + m_tileSize - 1) / m_tileSize;
+    int numTilesY = (m_size.y + m_tileSize - 1) / m_tileSize;
+    auto tileCount = static_cast<size_t>(numTilesX * numTilesY);
+    auto pixelCount = static_cast<size_t>(m_size.x * m_size.y);
+
+    if (m_tileOrder.size() != tileCount || m_tileOrderGrid != glm::ivec2(numTilesX, numTilesY)) {
+        m_tileOrder = createTileOrder(m_tileSchedule.order, numTilesX, numTilesY);
+        m_tileOrderGrid = {numTilesX, numTilesY};
+    }
+
+    // New size: every tile changes.
+    if (m_tileFrames.size() != tileCount) {
+        m_tileHashes.assign(tileCount, 0);
+        m_tileFrames.assign(tileCount, m_frameCount);
+    }
+
+    m_frameProgressive = m_progressive;
+
+    // The view changed: start accumulating again.
+    if (!m_frameProgressive || viewChanged || m_accumulation.size() != pixelCount || m_tileSamples.size() != tileCount) {
+        m_accumulation.resize(pixelCount);
+        m_deviations.resize(pixelCount);
+        m_tileSamples.assign(tileCount, 0);
+        m_tileErrors.assign(tileCount, 1.0f);
+    }
+
+    // Progressive frames don't move, so there is nothing to reproject.
+    m_frameReprojecting = m_reprojecting && !m_frameProgressive;
+
+    // Moved lights shade every point differently, so the last frame's colors are all stale.
+    if (!m_frameReprojecting
+        || worldChanged
+        || !areLightsEqual(previousLights, m_lights)
+        || m_history.size() != pixelCount) {
+        m_historyValid = false;
+    }
+
+    // Maps positions to the pixels of the last frame. (Inverse of computePrimaryDirection())
+    if (m_frameReprojecting) {
+        m_nextHistory.resize(pixelCount);
+        m_historyPosition = previousRayShoot.position;
+        m_historyTransform = glm::inverse(glm::mat3(
+                previousRayShoot.coefficient.x,
+                previousRayShoot.coefficient.y,
+                previousRayShoot.coefficient.z
+        ));
+    }
+
+    m_arena.execute([&]() {
+        auto grainSize = static_cast<size_t>(m_tileSchedule.grainSize);
+        auto tiles = tbb::blocked_range<int>(0, numTilesX * numTilesY, grainSize);
+
+        auto computeTiles = [&](const tbb::blocked_range<int> &range) {
+            int threadIndex = static_cast<int>(getThreadIndex());
+
+            for (int taskIndex = range.begin(); taskIndex < range.end(); taskIndex++) {
+                int tileIndex = m_tileOrder[taskIndex];
+                int tileY = tileIndex / numTilesX;
+                int tileX = tileIndex - tileY * numTilesX;
+                int x0 = tileX * m_tileSize;
+                int x1 = (std::min)(x0 + m_tileSize, m_size.x);
+                int y0 = tileY * m_tileSize;
+                int y1 = (std::min)(y0 + m_tileSize, m_size.y);
+
+                computeTile(threadIndex, x0, y0, x1, y1);
             }
+        };
+
+        switch (m_tileSchedule.partitioner) {
+            case TilePartitioner::Affinity:
+                // Replays the last frame's split, so threads get the tiles whose data they have cached.
+                tbb::parallel_for(tiles, computeTiles, m_affinityPartitioner);
+                break;
+            case TilePartitioner::Static:
+                tbb::parallel_for(tiles, computeTiles, tbb::static_partitioner());
+                break;
+            case TilePartitioner::Simple:
+                tbb::parallel_for(tiles, computeTiles, tbb::simple_partitioner());
+                break;
+            default:
+                tbb::parallel_for(tiles, computeTiles, tbb::auto_partitioner());
+                break;
         }
     });
 
-    int totalRayCount = sumAndClear(m_rayCounts);
+    m_rayStats = sumAndClear(m_threadStats);
 
-    AT_END(
-            auto endTime = getTime();
+    if (m_frameReprojecting) {
+        std::swap(m_history, m_nextHistory);
+        m_historyValid = true;
+    }
 
-            if (endTime > startTime) {
-                m_rps = static_cast<float>(totalRayCount) / computeDurationInSeconds(startTime, endTime);
-            }
-    );
+    updateSampleStats(numTilesX, numTilesY);
+
+    m_frameCount++;
+
+    m_governor.endFrame(m_rayStats.getRayCount());
+    m_rps = m_governor.getRPS();
 }
 
-const std::vector<glm::f32> &SceneModel::getPixels() const {
+const std::vector<unsigned char> &SceneModel::getPixels() const {
     return m_pixels;
 }
 
+void SceneModel::swapPixels(std::vector<unsigned char> &pixels) {
+    m_pixels.swap(pixels);
+}
+
+PixelFormat SceneModel::getPixelFormat() const {
+    return m_pixelFormat;
+}
+
+const std::vector<long long> &SceneModel::getTileFrames() const {
+    return m_tileFrames;
+}
+
+int SceneModel::getTileSize() const {
+    return m_tileSize;
+}
+
+const TileSchedule &SceneModel::getTileSchedule() const {
+    return m_tileSchedule;
+}
+
+void SceneModel::setTileSchedule(const TileSchedule &schedule) {
+    // Packets cover 4 pixels wide blocks.
+    if (schedule.tileSize < 0 || schedule.tileSize % 4 != 0) {
+        throw std::runtime_error("Tile size must be a multiple of 4");
+    }
+
+    if (schedule.grainSize < 1) {
+        throw std::runtime_error("Grain size must be positive");
+    }
+
+    m_tileSchedule = schedule;
+    m_tileOrder.clear();
+}
+
+long long SceneModel::getFrameCount() const {
+    return m_frameCount;
+}
+
 const glm::ivec2 &SceneModel::getSize() const {
     return m_size;
 }
@@ -189,25 +515,176 @@ float SceneModel::getRPS() const {
     return m_rps;
 }
 
+const RayStats &SceneModel::getRayStats() const {
+    return m_rayStats;
+}
+
+const Object *SceneModel::getMainObject() const {
+    auto world = std::atomic_load(&m_world);
+    return (world != nullptr) ? world->mainObject.get() : nullptr;
+}
+
+FrameGovernor &SceneModel::getGovernor() {
+    return m_governor;
+}
+
 void SceneModel::setSize(const glm::ivec2 &size) {
     if (m_size == size) {
         return;
     }
 
     m_size = size;
-    m_pixels = std::vector<glm::f32>(m_size.x * m_size.y * 4, 1.0f);
+    m_pixels = std::vector<unsigned char>(static_cast<size_t>(m_size.x * m_size.y) * getPixelSize(m_pixelFormat));
+    m_tileFrames.clear();
+    m_accumulation.clear();
+    m_deviations.clear();
+    m_history.clear();
+}
+
+bool SceneModel::isAnimating() const {
+    return m_animating;
+}
+
+void SceneModel::setAnimating(bool animating) {
+    m_animating = animating;
+}
+
+bool SceneModel::isProgressive() const {
+    return m_progressive;
+}
+
+void SceneModel::setProgressive(bool progressive) {
+    m_progressive = progressive;
+}
+
+float SceneModel::getSampleCount() const {
+    return m_sampleCount;
+}
+
+float SceneModel::getConvergence() const {
+    return m_convergence;
+}
+
+bool SceneModel::isConverged() const {
+    return m_activeTileCount == 0;
+}
+
+bool SceneModel::isReprojecting() const {
+    return m_reprojecting;
+}
+
+bool SceneModel::isFrameOutdated() const {
+    return m_animating
+           || m_frameCount == 0
+           || std::atomic_load(&m_world) != m_frameWorld
+           || m_progressive != m_frameProgressive
+           || (m_progressive && !isConverged());
 }
 
 void SceneModel::setMainObject(const std::string &mainObjectPath) {
-    delete m_mainObject;
-    delete m_roomObject;
-    delete m_mirrorObject;
-    rtcReleaseScene(m_scene);
+    int generation = ++m_loadGeneration;
+    m_loadProgress = 0.0f;
 
-    m_scene = rtcNewScene(m_device);
-    m_mainObject = new Object(m_device, m_scene, mainObjectPath);
+    std::shared_ptr<World> world;
 
-    auto box = m_mainObject->getAABB();
+    try {
+        world = createWorld(mainObjectPath, generation, getBuildProfile());
+    } catch (...) {
+        finishLoad(generation);
+        throw;
+    }
+
+    bool isPublished = false;
+
+    {
+        // Only publish the latest load, even if an older one finishes after it.
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+
+        if (world != nullptr && generation == m_loadGeneration) {
+            std::atomic_store(&m_world, std::shared_ptr<const World>(world));
+            isPublished = true;
+        }
+    }
+
+    finishLoad(generation);
+
+    // Written once the model is shown, so the first load of a model doesn't wait for its copy.
+    // Skipped if a newer load came in meanwhile.
+    if (isPublished && !world->isMeshCached && generation == m_loadGeneration) {
+        m_meshCache.store(mainObjectPath, world->mainObject->getMesh());
+    }
+}
+
+BuildProfile SceneModel::getBuildProfile() const {
+    return m_buildProfile;
+}
+
+void SceneModel::setBuildProfile(BuildProfile profile) {
+    m_buildProfile = profile;
+}
+
+BuildStats SceneModel::getBuildStats() const {
+    auto world = std::atomic_load(&m_world);
+    return (world != nullptr) ? world->buildStats : BuildStats{getBuildProfile(), 0.0, 0};
+}
+
+long long SceneModel::getMemoryUsage() const {
+    return m_deviceBytes + m_meshBytes;
+}
+
+long long SceneModel::getMemoryBudget() const {
+    return m_memoryBudget;
+}
+
+bool SceneModel::isLoading() const {
+    return m_finishedGeneration != m_loadGeneration;
+}
+
+float SceneModel::getLoadProgress() const {
+    return m_loadProgress;
+}
+
+std::shared_ptr<SceneModel::World> SceneModel::createWorld(
+        const std::string &mainObjectPath,
+        int generation,
+        BuildProfile profile
+) {
+    m_budgetExceeded = false;
+
+    auto world = std::make_shared<World>();
+    auto quality = getBuildQuality(profile);
+    auto startBytes = m_deviceBytes.load();
+
+    world->scene = rtcNewScene(m_device);
+    rtcSetSceneFlags(world->scene, getSceneFlags(profile));
+    rtcSetSceneBuildQuality(world->scene, quality);
+
+    auto mesh = m_meshCache.load(mainObjectPath);
+    auto meshBytes = static_cast<long long>(
+            mesh.vertexCount * sizeof(Object::Vertex) + mesh.faceCount * sizeof(Object::Face)
+    );
+
+    // Refuse models whose mesh alone doesn't fit, before Embree builds anything for them.
+    if (m_memoryBudget > 0 && getMemoryUsage() + meshBytes > m_memoryBudget) {
+        throw std::runtime_error(
+                "The model needs " + std::to_string(meshBytes / (1024 * 1024))
+                + " MB, which exceeds the memory budget"
+        );
+    }
+
+    world->isMeshCached = mesh.validated;
+    world->meshBytes = meshBytes;
+    world->meshBytesCounter = &m_meshBytes;
+    m_meshBytes += meshBytes;
+
+    world->mainObject.reset(new Object(m_device, world->scene, std::move(mesh), quality));
+
+    // Parsing can't be interrupted, but skip the build if a newer load came in meanwhile.
+    if (generation != m_loadGeneration) {
+        return nullptr;
+    }
+
+    auto box = world->mainObject->getAABB();
 
     float roomRadius = box.maxExtent / 2.0f * 3.0f;
     glm::vec3 roomCenter = box.center;
@@ -244,11 +721,12 @@ void SceneModel::setMainObject(const std::string &mainObjectPath) {
             {7, 5, 3}
     };
 
-    m_roomObject = new Object(
-            m_device, m_scene,
+    world->roomObject.reset(new Object(
+            m_device, world->scene,
             roomVertices.data(), roomVertices.size(),
-            roomFaces.data(), roomFaces.size()
-    );
+            roomFaces.data(), roomFaces.size(),
+            quality
+    ));
 
     std::vector<Object::Vertex> mirrorVertices = {
             {roomXMin, roomYMin, roomZMin},
@@ -262,20 +740,74 @@ void SceneModel::setMainObject(const std::string &mainObjectPath) {
             {2, 3, 1}
     };
 
-    m_mirrorObject = new Object(
-            m_device, m_scene,
+    world->mirrorObject.reset(new Object(
+            m_device, world->scene,
             mirrorVertices.data(), mirrorVertices.size(),
-            mirrorFaces.data(), mirrorFaces.size()
-    );
+            mirrorFaces.data(), mirrorFaces.size(),
+            quality
+    ));
+
+    struct BuildMonitor {
+        SceneModel *model;
+        int generation;
+    };
+
+    BuildMonitor monitor = {this, generation};
+
+    // Called from the build threads. Returning false cancels the build.
+    rtcSetSceneProgressMonitorFunction(world->scene, [](void *userPtr, double progress) {
+        auto monitor = static_cast<BuildMonitor *>(userPtr);
 
-    rtcCommitScene(m_scene);
+        if (monitor->generation != monitor->model->m_loadGeneration) {
+            return false;
+        }
+
+        monitor->model->m_loadProgress = static_cast<float>(progress);
+        return true;
+    }, &monitor);
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    rtcCommitScene(world->scene);
+    rtcSetSceneProgressMonitorFunction(world->scene, nullptr, nullptr);
+
+    auto isOverBudget = m_budgetExceeded.exchange(false);
+
+    if (generation != m_loadGeneration) {
+        return nullptr;
+    }
+
+    // The build didn't fit in the budget: retry with the compact profile, after freeing this one.
+    if (isOverBudget) {
+        world.reset();
+
+        if (profile != BuildProfile::FastLoad) {
+            return createWorld(mainObjectPath, generation, BuildProfile::FastLoad);
+        }
 
-    updateCamera();
-    updateLights();
+        throw std::runtime_error("The scene doesn't fit in the memory budget");
+    }
+
+    auto buildTime = std::chrono::steady_clock::now() - startTime;
+
+    // Other loads running at the same time also count here. It's only for display.
+    world->buildStats = {
+            profile,
+            std::chrono::duration_cast<std::chrono::duration<double>>(buildTime).count(),
+            m_deviceBytes - startBytes
+    };
+
+    return world;
+}
+
+void SceneModel::finishLoad(int generation) {
+    if (generation == m_loadGeneration) {
+        m_finishedGeneration = generation;
+    }
 }
 
 void SceneModel::updateCamera() {
-    auto box = m_mainObject->getAABB();
+    auto box = m_frameWorld->mainObject->getAABB();
 
     m_camera.position = box.center + glm::vec3(0.0f, box.maxExtent * 0.5f, 0.0f);
     m_camera.center = box.center;
@@ -283,13 +815,13 @@ void SceneModel::updateCamera() {
 }
 
 void SceneModel::updateLights() {
-    auto box = m_mainObject->getAABB();
+    auto box = m_frameWorld->mainObject->getAABB();
 
     m_lights[0].position = box.center + glm::vec3(0.0f, box.maxExtent * 1.0f, 0.0f);
 }
 
 void SceneModel::updateRayShoot() {
-    float fovScale = 1.0f / std::tanf(0.4f * glm::radians(m_camera.fov));
+    float fovScale = 1.0f / std::tan(0.4f * glm::radians(m_camera.fov));
     glm::vec3 cameraDirection = glm::normalize(m_camera.center - m_camera.position);
     glm::vec3 cameraU = glm::normalize(glm::cross(m_camera.up, cameraDirection));
     glm::vec3 cameraV = glm::normalize(glm::cross(cameraDirection, cameraU));
@@ -312,7 +844,7 @@ void SceneModel::animateCamera() {
         return;
     }
 
-    auto box = m_mainObject->getAABB();
+    auto box = m_frameWorld->mainObject->getAABB();
     glm::mat4 matrix = glm::rotate(glm::mat4(1.0f), -0.01f, glm::vec3(0.0f, 0.0f, 1.0f));
 
     m_camera.position = glm::vec3(matrix * glm::vec4(m_camera.position - box.center, 1.0f)) + box.center;
@@ -323,142 +855,435 @@ void SceneModel::animateLights() {
         return;
     }
 
-    auto box = m_mainObject->getAABB();
+    auto box = m_frameWorld->mainObject->getAABB();
     glm::mat4 matrix = glm::rotate(glm::mat4(1.0f), -0.03f, glm::vec3(0.0f, 0.0f, 1.0f));
 
     m_lights[0].position = glm::vec3(matrix * glm::vec4(m_lights[0].position - box.center, 1.0f)) + box.center;
 }
 
-void SceneModel::computePixel(int threadIndex, int pixelX, int pixelY) {
-    auto context = RTCIntersectContext();
-    rtcInitIntersectContext(&context);
+bool SceneModel::areLightsEqual(const std::vector<Light> &a, const std::vector<Light> &b) {
+    return a.size() == b.size()
+           && std::equal(a.begin(), a.end(), b.begin(), [](const Light &x, const Light &y) {
+               return x.position == y.position
+                      && x.ambientColor == y.ambientColor
+                      && x.diffuseColor == y.diffuseColor
+                      && x.specularColor == y.specularColor;
+           });
+}
+
+void SceneModel::computeTile(int threadIndex, int x0, int y0, int x1, int y1) {
+    auto &stream = m_rayStreams[threadIndex];
+    auto &stats = m_threadStats[threadIndex];
+    int tileWidth = x1 - x0;
+    int tileHeight = y1 - y0;
+    int numTilesX = (m_size.x + m_tileSize - 1) / m_tileSize;
+    auto tileIndex = static_cast<size_t>((y0 / m_tileSize) * numTilesX + x0 / m_tileSize);
+
+    if (m_frameProgressive) {
+        // Noisy tiles get several samples, converged ones none.
+        auto sampleCount = getTileSampleBudget(tileIndex);
+
+        for (int i = 0; i < sampleCount; i++) {
+            auto sampleIndex = m_tileSamples[tileIndex];
+
+            // The first sample is at the pixel corner, like without progressive mode.
+            auto sampleOffset = glm::vec2(getHalton(sampleIndex, 2), getHalton(sampleIndex, 3));
+
+            traceTile(stream, stats, x0, y0, tileWidth, tileHeight, sampleOffset);
+            accumulateTile(stream, tileIndex, x0, y0, tileWidth, tileHeight);
+        }
+
+        resolveTile(stream, tileIndex, x0, y0, tileWidth, tileHeight);
+    } else {
+        traceTile(stream, stats, x0, y0, tileWidth, tileHeight, glm::vec2(0.0f));
+    }
+
+    auto pixelSize = getPixelSize(m_pixelFormat);
+    auto hash = 14695981039346656037ull;
+
+    for (int y = 0; y < tileHeight; y++) {
+        setPixels(x0, y0 + y, &stream.colors[y * tileWidth], tileWidth);
+
+        auto index = static_cast<size_t>((y0 + y) * m_size.x + x0) * pixelSize;
+        hash = hashPixels(&m_pixels[index], tileWidth * pixelSize, hash);
+    }
+
+    // Remember when the tile last changed, so only changed tiles are uploaded.
+    if (m_tileHashes[tileIndex] != hash) {
+        m_tileHashes[tileIndex] = hash;
+        m_tileFrames[tileIndex] = m_frameCount;
+    }
+}
 
-    glm::vec3 resultColor = {0.0f, 0.0f, 0.0f};
+// Traces one sample of each pixel of the tile into stream.colors.
+void SceneModel::traceTile(
+        RayStream &stream,
+        RayStats &stats,
+        int x0,
+        int y0,
+        int tileWidth,
+        int tileHeight,
+        const glm::vec2 &sampleOffset
+) {
+    stream.colors.assign(static_cast<size_t>(tileWidth * tileHeight), glm::vec3(0.0f));
 
     if (objectsExist()) {
+        // Full tiles are traced as packets. Ragged tiles at the image edges fall back to a ray stream.
+        bool usePackets = (tileWidth == m_tileSize) && (tileHeight == m_tileSize) && (m_packetSize > 0);
+        int blockWidth = usePackets ? packetWidth : tileWidth;
+        int blockHeight = usePackets ? m_packetSize / packetWidth : 1;
+
+        stream.rays.clear();
+        stream.paths.clear();
+
         // 처음 발사한 광선. (카메라 -> 물체)
-        resultColor = shootRayAndComputeColor(
-                threadIndex,
-                context,
-                m_rayShoot.position,
-                glm::normalize(
-                        m_rayShoot.coefficient.x * static_cast<float>(pixelX)
-                        + m_rayShoot.coefficient.y * static_cast<float>(pixelY)
-                        + m_rayShoot.coefficient.z
-                )
-        );
+        // With packets, the rays of each pixel block are stored next to each other.
+        for (int blockY = 0; blockY < tileHeight; blockY += blockHeight) {
+            for (int blockX = 0; blockX < tileWidth; blockX += blockWidth) {
+                for (int y = blockY; y < blockY + blockHeight; y++) {
+                    for (int x = blockX; x < blockX + blockWidth; x++) {
+                        stream.rays.push_back(createRay(
+                                m_rayShoot.position,
+                                computePrimaryDirection(x0 + x, y0 + y, sampleOffset),
+                                0.01f
+                        ));
+
+                        stream.paths.push_back({y * tileWidth + x, glm::vec3(1.0f)});
+                    }
+                }
+            }
+        }
+
+        auto context = RTCIntersectContext();
+        rtcInitIntersectContext(&context);
+        context.flags = RTC_INTERSECT_CONTEXT_FLAG_COHERENT;
+
+        if (usePackets && m_packetSize == 16) {
+            tracePackets<RTCRayHit16, 16>(context, stream.rays);
+        } else if (usePackets) {
+            tracePackets<RTCRayHit8, 8>(context, stream.rays);
+        } else {
+            traceRays(context, stream.rays);
+        }
+
+        stats.primaryRays += static_cast<long long>(stream.rays.size());
+
+        if (m_frameReprojecting) {
+            reuseHistory(stream, stats, x0, y0, tileWidth);
+        }
+
+        // Shadow and reflection rays are incoherent, so they are traced as streams.
+        context.flags = RTC_INTERSECT_CONTEXT_FLAG_INCOHERENT;
+
+        for (int depth = 0; !stream.rays.empty(); depth++) {
+            shadeHits(stream, depth, stats);
+
+            traceShadowRays(context, stream.shadowRays);
+            stats.shadowRays += static_cast<long long>(stream.shadowRays.size());
+
+            for (size_t i = 0; i < stream.shadowRays.size(); i++) {
+                auto &shadow = stream.shadows[i];
+                bool isOccluded = stream.shadowRays[i].tfar < 0;
+
+                // 물체와 광원 사이에 다른 것이 있을 경우, 그 부분을 그림자로 표시한다.
+                stream.colors[shadow.pixel] += isOccluded ? shadow.color * 0.3f : shadow.color;
+            }
+
+            std::swap(stream.rays, stream.bounceRays);
+            std::swap(stream.paths, stream.bouncePaths);
+
+            traceRays(context, stream.rays);
+            stats.reflectionRays += static_cast<long long>(stream.rays.size());
+        }
     }
 
-    int index = (pixelY * m_size.x + pixelX) * 4;
+    if (m_frameReprojecting) {
+        for (int y = 0; y < tileHeight; y++) {
+            for (int x = 0; x < tileWidth; x++) {
+                m_nextHistory[(y0 + y) * m_size.x + x0 + x].color = stream.colors[y * tileWidth + x];
+            }
+        }
+    }
+}
+
+// Temporal reprojection: primary hits seen in the last frame take its color instead of being shaded again.
+// Removes those rays from the stream, and records every hit for the next frame.
+void SceneModel::reuseHistory(RayStream &stream, RayStats &stats, int x0, int y0, int tileWidth) {
+    float tolerance = reprojectionTolerance * m_frameWorld->mainObject->getAABB().maxExtent;
+    auto mirrorID = m_frameWorld->mirrorObject->getGeometryID();
+    size_t count = 0;
+
+    for (size_t i = 0; i < stream.rays.size(); i++) {
+        auto &ray = stream.rays[i];
+        auto &path = stream.paths[i];
+        int x = x0 + path.pixel % tileWidth;
+        int y = y0 + path.pixel / tileWidth;
+        auto &history = m_nextHistory[y * m_size.x + x];
+
+        history.geomID = ray.hit.geomID;
+        history.position = glm::vec3(ray.ray.org_x, ray.ray.org_y, ray.ray.org_z)
+                           + ray.ray.tfar * glm::vec3(ray.ray.dir_x, ray.ray.dir_y, ray.ray.dir_z);
+
+        // Pixels expire at different frames, so they aren't all traced again in the same frame.
+        history.age = m_historyValid ? 0 : (x * 5 + y * 3) % m_reprojectionAge;
+
+        // Misses are cheap, and mirrors change with the view.
+        if (m_historyValid && history.geomID != RTC_INVALID_GEOMETRY_ID && history.geomID != mirrorID) {
+            auto previous = findHistory(history.position);
+
+            if (previous != nullptr
+                && previous->geomID == history.geomID
+                && previous->age + 1 < m_reprojectionAge
+                && glm::distance(previous->position, history.position) < tolerance) {
+                history.age = previous->age + 1;
+                stream.colors[path.pixel] = previous->color;
+                stats.reprojectedPixels++;
+                continue;
+            }
+        }
 
-    m_pixels[index] = resultColor.r;
-    m_pixels[index + 1] = resultColor.g;
-    m_pixels[index + 2] = resultColor.b;
-    m_pixels[index + 3] = 1.0f;
+        stream.rays[count] = ray;
+        stream.paths[count] = path;
+        count++;
+    }
+
+    stream.rays.resize(count);
+    stream.paths.resize(count);
 }
 
-glm::vec3 SceneModel::shootRayAndComputeColor(
-        int threadIndex,
-        RTCIntersectContext &context,
-        const glm::vec3 &position,
-        const glm::vec3 &direction,
-        int depth
-) {
-    auto ray = createRay(position, direction, 0.01f);
-    rtcIntersect1(m_scene, &context, &ray);
-    m_rayCounts[threadIndex]++;
+// Pixel of the last frame the position was seen through.
+const SceneModel::HistoryPixel *SceneModel::findHistory(const glm::vec3 &position) const {
+    auto pixel = m_historyTransform * (position - m_historyPosition);
+
+    if (pixel.z <= 0.0f) {
+        return nullptr;
+    }
+
+    auto x = static_cast<int>(std::lround(pixel.x / pixel.z));
+    auto y = static_cast<int>(std::lround(pixel.y / pixel.z));
+
+    if (x < 0 || y < 0 || x >= m_size.x || y >= m_size.y) {
+        return nullptr;
+    }
 
-    glm::vec3 rayOrigin = {ray.ray.org_x, ray.ray.org_y, ray.ray.org_z};
-    glm::vec3 rayDirection = {ray.ray.dir_x, ray.ray.dir_y, ray.ray.dir_z};
-    float rayLength = ray.ray.tfar;
+    return &m_history[y * m_size.x + x];
+}
 
-    glm::vec3 hitPosition = rayOrigin + rayLength * rayDirection;
-    auto hitID = ray.hit.geomID;
+template<typename RayHitN, int N>
+void SceneModel::tracePackets(RTCIntersectContext &context, std::vector<RTCRayHit> &rays) {
+    RayHitN packet;
+    alignas(64) int valid[N];
 
-    if (hitID == RTC_INVALID_GEOMETRY_ID) {
-        return {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < N; i++) {
+        valid[i] = -1;
     }
 
-    glm::vec3 resultColor = {0.0f, 0.0f, 0.0f};
-    glm::vec3 objectColor = {1.0f, 1.0f, 1.0f};
+    for (size_t i = 0; i < rays.size(); i += N) {
+        packRays(&rays[i], packet, N);
+        intersectPacket(valid, m_frameWorld->scene, &context, &packet);
+        unpackRays(packet, &rays[i], N);
+    }
+}
 
-    if (hitID == m_mainObject->getGeometryID()) {
-        objectColor = m_mainColor;
-    } else if (hitID == m_roomObject->getGeometryID()) {
-        objectColor = m_roomColor;
-    } else if (hitID == m_mirrorObject->getGeometryID()) {
-        objectColor = m_mirrorColor;
+void SceneModel::traceRays(RTCIntersectContext &context, std::vector<RTCRayHit> &rays) {
+    if (rays.empty()) {
+        return;
     }
 
-    glm::vec3 N = glm::normalize(glm::vec3(ray.hit.Ng_x, ray.hit.Ng_y, ray.hit.Ng_z));
+    auto scene = m_frameWorld->scene;
+    rtcIntersect1M(scene, &context, rays.data(), static_cast<unsigned int>(rays.size()), sizeof(RTCRayHit));
+}
 
-    for (auto &light: m_lights) {
-        // Diffuse reflection(난반사) 구현.
-        glm::vec3 L = glm::normalize(light.position - hitPosition);
-        float NdotL = glm::dot(N, L);
-        float lambertian = (NdotL < 0.0f) ? 0.0f : NdotL;
+void SceneModel::traceShadowRays(RTCIntersectContext &context, std::vector<RTCRay> &rays) {
+    if (rays.empty()) {
+        return;
+    }
 
-        // 거리에 따른 빛의 감쇠 구현.
-        float D = glm::distance(hitPosition, light.position) / m_mainObject->getAABB().maxExtent;
-        float attenuation = 1.0f / (1.0f + D * 0.3f);
+    auto scene = m_frameWorld->scene;
+    rtcOccluded1M(scene, &context, rays.data(), static_cast<unsigned int>(rays.size()), sizeof(RTCRay));
+}
 
-        glm::vec3 color = (light.ambientColor + lambertian * light.diffuseColor) * objectColor * attenuation;
+void SceneModel::shadeHits(RayStream &stream, int depth, RayStats &stats) {
+    float maxExtent = m_frameWorld->mainObject->getAABB().maxExtent;
 
-        // 그림자 구현을 위해 물체에서 광원으로 광선을 발사한다.
-        bool isOccluded = shootRayToLightAndCheckOcclusion(
-                threadIndex,
-                context,
-                hitPosition,
-                L,
-                light
-        );
+    stream.shadowRays.clear();
+    stream.shadows.clear();
+    stream.bounceRays.clear();
+    stream.bouncePaths.clear();
+
+    for (size_t i = 0; i < stream.rays.size(); i++) {
+        auto &ray = stream.rays[i];
+        auto &path = stream.paths[i];
+        auto hitID = ray.hit.geomID;
+
+        if (hitID == RTC_INVALID_GEOMETRY_ID) {
+            stats.misses++;
+            continue;
+        }
+
+        stats.hits++;
+
+        glm::vec3 rayOrigin = {ray.ray.org_x, ray.ray.org_y, ray.ray.org_z};
+        glm::vec3 rayDirection = {ray.ray.dir_x, ray.ray.dir_y, ray.ray.dir_z};
+        float rayLength = ray.ray.tfar;
+
+        glm::vec3 hitPosition = rayOrigin + rayLength * rayDirection;
+        glm::vec3 objectColor = {1.0f, 1.0f, 1.0f};
+
+        if (hitID == m_frameWorld->mainObject->getGeometryID()) {
+            objectColor = m_mainColor;
+        } else if (hitID == m_frameWorld->roomObject->getGeometryID()) {
+            objectColor = m_roomColor;
+        } else if (hitID == m_frameWorld->mirrorObject->getGeometryID()) {
+            objectColor = m_mirrorColor;
+        }
+
+        glm::vec3 N = glm::normalize(glm::vec3(ray.hit.Ng_x, ray.hit.Ng_y, ray.hit.Ng_z));
+
+        for (auto &light: m_lights) {
+            // Diffuse reflection(난반사) 구현.
+            glm::vec3 L = glm::normalize(light.position - hitPosition);
+            float NdotL = glm::dot(N, L);
+            float lambertian = (NdotL < 0.0f) ? 0.0f : NdotL;
+
+            // 거리에 따른 빛의 감쇠 구현.
+            float lightDistance = glm::distance(hitPosition, light.position);
+            float D = lightDistance / maxExtent;
+            float attenuation = 1.0f / (1.0f + D * 0.3f);
+
+            glm::vec3 color = (light.ambientColor + lambertian * light.diffuseColor) * objectColor * attenuation;
 
-        // 물체와 광원 사이에 다른 것이 있을 경우...
-        if (isOccluded) {
-            // 그 부분을 그림자로 표시한다.
-            color *= 0.3f;
+            // 그림자 구현을 위해 물체에서 광원으로 광선을 발사한다.
+            stream.shadowRays.push_back(createRay(hitPosition, L, 0.01f, lightDistance).ray);
+            stream.shadows.push_back({path.pixel, path.weight * color});
         }
 
-        resultColor += color;
+        // 빛이 반사되는 물체일 경우, 물체 위에서 광선을 발사하여 빛의 반사를 구현한다.
+        if (hitID == m_frameWorld->mirrorObject->getGeometryID() && depth < 1) {
+            stream.bounceRays.push_back(createRay(hitPosition, glm::reflect(rayDirection, N), 0.01f));
+            stream.bouncePaths.push_back({path.pixel, path.weight * 0.6f});
+        }
     }
+}
 
-    // 빛이 반사되는 물체일 경우...
-    if (hitID == m_mirrorObject->getGeometryID() && depth < 1) {
-        // 물체 위에서 광선을 발사하여 빛의 반사를 구현한다.
-        glm::vec3 reflectionColor = shootRayAndComputeColor(
-                threadIndex,
-                context,
-                hitPosition,
-                glm::reflect(rayDirection, N),
-                depth + 1
-        );
+bool SceneModel::isTileConverged(size_t tileIndex) const {
+    auto sampleCount = m_tileSamples[tileIndex];
 
-        resultColor += 0.6f * reflectionColor;
+    return sampleCount >= m_maxSamples
+           || (sampleCount >= minTileSamples && m_tileErrors[tileIndex] < m_convergenceThreshold);
+}
+
+// Samples of the tile in this frame: more for tiles further from the target error.
+int SceneModel::getTileSampleBudget(size_t tileIndex) const {
+    if (isTileConverged(tileIndex)) {
+        return 0;
     }
 
-    return resultColor;
+    auto sampleCount = m_tileSamples[tileIndex];
+
+    // Until the error is known, one per frame, so the first frames come quickly.
+    if (sampleCount < minTileSamples) {
+        return 1;
+    }
+
+    auto budget = static_cast<int>(m_tileErrors[tileIndex] / m_convergenceThreshold);
+
+    return (std::max)(1, (std::min)({budget, maxTileSamplesPerFrame, m_maxSamples - sampleCount}));
 }
 
-bool SceneModel::shootRayToLightAndCheckOcclusion(
-        int threadIndex,
-        RTCIntersectContext &context,
-        const glm::vec3 &position,
-        const glm::vec3 &direction,
-        const SceneModel::Light &light
-) {
-    auto ray = createRay(
-            position,
-            direction,
-            0.01f,
-            glm::distance(position, light.position)
-    );
+// Adds the sample in stream.colors to the tile's sums, and estimates the error of their average.
+void SceneModel::accumulateTile(RayStream &stream, size_t tileIndex, int x0, int y0, int tileWidth, int tileHeight) {
+    auto sampleCount = ++m_tileSamples[tileIndex];
+    auto weight = 1.0f / static_cast<float>(sampleCount);
+    float error = 0.0f;
+
+    for (int y = 0; y < tileHeight; y++) {
+        for (int x = 0; x < tileWidth; x++) {
+            auto index = static_cast<size_t>((y0 + y) * m_size.x + x0 + x);
+            auto &sum = m_accumulation[index];
+            auto &deviation = m_deviations[index];
+            auto &color = stream.colors[y * tileWidth + x];
+
+            if (sampleCount == 1) {
+                sum = color;
+                deviation = 0.0f;
+                continue;
+            }
+
+            // Welford's update of the squared deviations of the luminance.
+            auto luminance = getLuminance(color);
+            auto previousMean = getLuminance(sum) / static_cast<float>(sampleCount - 1);
+
+            sum += color;
+            deviation += (luminance - previousMean) * (luminance - getLuminance(sum) * weight);
+
+            // Standard error of the mean.
+            auto variance = (std::max)(deviation, 0.0f) / static_cast<float>(sampleCount - 1);
+            error += std::sqrt(variance * weight);
+        }
+    }
+
+    m_tileErrors[tileIndex] = (sampleCount == 1) ? 1.0f : error / static_cast<float>(tileWidth * tileHeight);
+}
 
-    rtcOccluded1(m_scene, &context, &(ray.ray));
-    m_rayCounts[threadIndex]++;
+// Puts the average of the tile's samples in stream.colors.
+void SceneModel::resolveTile(RayStream &stream, size_t tileIndex, int x0, int y0, int tileWidth, int tileHeight) {
+    auto weight = 1.0f / static_cast<float>((std::max)(m_tileSamples[tileIndex], 1));
+
+    stream.colors.resize(static_cast<size_t>(tileWidth * tileHeight));
+
+    for (int y = 0; y < tileHeight; y++) {
+        for (int x = 0; x < tileWidth; x++) {
+            stream.colors[y * tileWidth + x] = m_accumulation[(y0 + y) * m_size.x + x0 + x] * weight;
+        }
+    }
+}
+
+void SceneModel::updateSampleStats(int numTilesX, int numTilesY) {
+    if (!m_frameProgressive) {
+        m_sampleCount = 1.0f;
+        m_convergence = 1.0f;
+        m_activeTileCount = numTilesX * numTilesY;
+        return;
+    }
+
+    double sampleCount = 0.0;
+
+    m_convergence = 0.0f;
+    m_activeTileCount = 0;
+
+    for (int tileY = 0; tileY < numTilesY; tileY++) {
+        for (int tileX = 0; tileX < numTilesX; tileX++) {
+            auto tileIndex = static_cast<size_t>(tileY * numTilesX + tileX);
+            int tileWidth = (std::min)(m_tileSize, m_size.x - tileX * m_tileSize);
+            int tileHeight = (std::min)(m_tileSize, m_size.y - tileY * m_tileSize);
+
+            sampleCount += static_cast<double>(m_tileSamples[tileIndex]) * tileWidth * tileHeight;
+            m_convergence = (std::max)(m_convergence, m_tileErrors[tileIndex]);
+
+            if (!isTileConverged(tileIndex)) {
+                m_activeTileCount++;
+            }
+        }
+    }
+
+    m_sampleCount = static_cast<float>(sampleCount / (static_cast<double>(m_size.x) * m_size.y));
+}
+
+glm::vec3 SceneModel::computePrimaryDirection(int pixelX, int pixelY, const glm::vec2 &offset) const {
+    return glm::normalize(
+            m_rayShoot.coefficient.x * (static_cast<float>(pixelX) + offset.x)
+            + m_rayShoot.coefficient.y * (static_cast<float>(pixelY) + offset.y)
+            + m_rayShoot.coefficient.z
+    );
+}
 
-    return ray.ray.tfar < 0;
+// Encodes a row of pixels, starting from (pixelX, pixelY).
+void SceneModel::setPixels(int pixelX, int pixelY, const glm::vec3 *colors, int count) {
+    auto index = static_cast<size_t>(pixelY * m_size.x + pixelX) * getPixelSize(m_pixelFormat);
+    encodePixels(m_pixelFormat, colors, static_cast<size_t>(count), &m_pixels[index]);
 }
 
-bool SceneModel::objectsExist() {
-    return (m_mainObject != nullptr) && (m_roomObject != nullptr);
+bool SceneModel::objectsExist() const {
+    return m_frameWorld != nullptr;
 }
@@ -1,18 +1,28 @@
 #pragma once
 
-#include <QObject>
-
 #include <embree3/rtcore.h>
+#include <tbb/cache_aligned_allocator.h>
+#include <tbb/partitioner.h>
 #include <glm/glm.hpp>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "../base/Object.hpp"
+#include "../base/MeshCache.hpp"
+#include "../base/Options.hpp"
+#include "../base/FrameGovernor.hpp"
+#include "../base/BuildProfile.hpp"
+#include "../base/RenderArena.hpp"
+#include "../base/PixelFormat.hpp"
+#include "../base/TileSchedule.hpp"
+#include "../base/RayStats.hpp"
 
-class SceneModel : public QObject {
-Q_OBJECT
-
+class SceneModel {
 private:
     struct Camera {
         glm::vec3 position;
@@ -33,55 +43,248 @@ private:
         glm::vec<3, glm::vec3> coefficient;
     };
 
+    // Pixel (inside the tile) a ray contributes to, and how much.
+    struct RayPath {
+        int pixel;
+        glm::vec3 weight;
+    };
+
+    // Color a shadow ray's pixel receives unless the light is occluded.
+    struct RayShadow {
+        int pixel;
+        glm::vec3 color;
+    };
+
+    // Scene and objects traced by a frame. Loading builds a whole new world off-thread and swaps it in.
+    struct World {
+        RTCScene scene = nullptr;
+        std::unique_ptr<Object> mainObject;
+        std::unique_ptr<Object> roomObject;
+        std::unique_ptr<Object> mirrorObject;
+        BuildStats buildStats;
+
+        // Whether the main mesh came from the mesh cache, so it needn't be stored again.
+        bool isMeshCached = false;
+
+        // Mesh memory Embree doesn't see, counted while the world is alive.
+        long long meshBytes = 0;
+        std::atomic<long long> *meshBytesCounter = nullptr;
+
+        ~World();
+    };
+
+    // A pixel's primary hit and color, kept for the next frame. (Temporal reprojection)
+    struct HistoryPixel {
+        glm::vec3 position;
+        glm::vec3 color;
+        unsigned int geomID = RTC_INVALID_GEOMETRY_ID;
+
+        // Frames the color has been reused for.
+        int age = 0;
+    };
+
+    // Per-thread buffers of the staged tile pipeline. (Rays -> Hits -> Shadow rays & Bounce rays)
+    struct RayStream {
+        std::vector<RTCRayHit> rays;
+        std::vector<RayPath> paths;
+        std::vector<RTCRayHit> bounceRays;
+        std::vector<RayPath> bouncePaths;
+        std::vector<RTCRay> shadowRays;
+        std::vector<RayShadow> shadows;
+        std::vector<glm::vec3> colors;
+    };
+
 public:
-    explicit SceneModel(QObject *parent = nullptr);
-    ~SceneModel() override;
+    typedef std::vector<RayStats, tbb::cache_aligned_allocator<RayStats>> ThreadStats;
+
+    explicit SceneModel(const Options &options);
+    ~SceneModel();
 
     void render();
 
-    const std::vector<glm::f32> &getPixels() const;
+    // Pixels of the last frame, in getPixelFormat().
+    const std::vector<unsigned char> &getPixels() const;
+
+    // Exchanges the rendered pixels with the given buffer, which becomes the target of the next frame.
+    void swapPixels(std::vector<unsigned char> &pixels);
+    PixelFormat getPixelFormat() const;
+
+    // Last frame each tile's pixels changed in, row by row. (Frames are counted from 0)
+    const std::vector<long long> &getTileFrames() const;
+
+    // Tile size of the last frame. (The schedule's, or the one picked for the frame size)
+    int getTileSize() const;
+
+    const TileSchedule &getTileSchedule() const;
+    // Applies from the next frame. Not thread-safe: call it between frames, on the rendering thread.
+    void setTileSchedule(const TileSchedule &schedule);
+    long long getFrameCount() const;
     const glm::ivec2 &getSize() const;
     float getRPS() const;
+    const RayStats &getRayStats() const;
+    FrameGovernor &getGovernor();
+    // Valid until the next setMainObject().
+    const Object *getMainObject() const;
 
     void setSize(const glm::ivec2 &size);
+
+    // Without animation, frames only change with the size or the model.
+    bool isAnimating() const;
+    void setAnimating(bool animating);
+
+    // Progressive mode: while the view doesn't change, each frame adds a jittered sample to every pixel.
+    bool isProgressive() const;
+    void setProgressive(bool progressive);
+
+    // Samples averaged per pixel in the last frame. Noisy tiles take more samples.
+    float getSampleCount() const;
+
+    // Largest estimated error of a tile. (Mean standard error of its pixels' luminance, 1 while unknown)
+    float getConvergence() const;
+
+    // Whether every tile reached the error target or the sample limit, so sampling stopped.
+    bool isConverged() const;
+
+    // Temporal reprojection: pixels whose primary hit was seen in the last frame reuse its color,
+    // for up to --reproject-age frames, instead of tracing shadow and reflection rays. Only while the lights stay put.
+    bool isReprojecting() const;
+
+    // Whether the next frame would differ from the last one, at the same size.
+    // In progressive mode, frames are outdated until the image converges.
+    bool isFrameOutdated() const;
+    // Thread-safe. Frames keep rendering the previous model until the new one is built.
+    // A newer call cancels the build of an older one, which then returns without changing the scene.
     void setMainObject(const std::string &mainObjectPath);
 
+    // Applies from the next load.
+    BuildProfile getBuildProfile() const;
+    void setBuildProfile(BuildProfile profile);
+
+    // Build of the latest loaded model.
+    BuildStats getBuildStats() const;
+
+    // Embree allocations plus the meshes of the loaded models, in bytes.
+    long long getMemoryUsage() const;
+
+    // Zero or less means no budget.
+    long long getMemoryBudget() const;
+
+    bool isLoading() const;
+
+    // BVH build progress of the latest load. (0 ~ 1)
+    float getLoadProgress() const;
+
 private:
+    std::shared_ptr<World> createWorld(const std::string &mainObjectPath, int generation, BuildProfile profile);
+    void finishLoad(int generation);
+
     void updateCamera();
     void updateLights();
     void updateRayShoot();
     void animateCamera();
     void animateLights();
-    void computePixel(int threadIndex, int pixelX, int pixelY);
-
-    glm::vec3 shootRayAndComputeColor(
-            int threadIndex,
-            RTCIntersectContext &context,
-            const glm::vec3 &position,
-            const glm::vec3 &direction,
-            int depth = 0
+    // Whether the lights would shade every point the same.
+    static bool areLightsEqual(const std::vector<Light> &a, const std::vector<Light> &b);
+    void computeTile(int threadIndex, int x0, int y0, int x1, int y1);
+    void traceTile(
+            RayStream &stream,
+            RayStats &stats,
+            int x0,
+            int y0,
+            int tileWidth,
+            int tileHeight,
+            const glm::vec2 &sampleOffset
     );
 
-    bool shootRayToLightAndCheckOcclusion(
-            int threadIndex,
-            RTCIntersectContext &context,
-            const glm::vec3 &position,
-            const glm::vec3 &direction,
-            const Light &light
-    );
+    template<typename RayHitN, int N>
+    void tracePackets(RTCIntersectContext &context, std::vector<RTCRayHit> &rays);
 
-    bool objectsExist();
+    void traceRays(RTCIntersectContext &context, std::vector<RTCRayHit> &rays);
+    void traceShadowRays(RTCIntersectContext &context, std::vector<RTCRay> &rays);
+    void shadeHits(RayStream &stream, int depth, RayStats &stats);
+    void reuseHistory(RayStream &stream, RayStats &stats, int x0, int y0, int tileWidth);
+    const HistoryPixel *findHistory(const glm::vec3 &position) const;
+    bool isTileConverged(size_t tileIndex) const;
+    int getTileSampleBudget(size_t tileIndex) const;
+    void accumulateTile(RayStream &stream, size_t tileIndex, int x0, int y0, int tileWidth, int tileHeight);
+    void resolveTile(RayStream &stream, size_t tileIndex, int x0, int y0, int tileWidth, int tileHeight);
+    void updateSampleStats(int numTilesX, int numTilesY);
 
-    std::vector<glm::f32> m_pixels = {0.0f, 0.0f, 0.0f, 1.0f};
-    std::vector<int> m_rayCounts = {0};
+    glm::vec3 computePrimaryDirection(int pixelX, int pixelY, const glm::vec2 &offset) const;
+    void setPixels(int pixelX, int pixelY, const glm::vec3 *colors, int count);
+
+    bool objectsExist() const;
+
+    std::vector<unsigned char> m_pixels;
+    ThreadStats m_threadStats = ThreadStats(1);
+    RayStats m_rayStats;
+    std::vector<RayStream> m_rayStreams = std::vector<RayStream>(1);
     float m_rps = 0.0f;
+    long long m_frameCount = 0;
+    std::vector<std::uint64_t> m_tileHashes;
+    std::vector<long long> m_tileFrames;
+    FrameGovernor m_governor;
+    RenderArena m_arena;
+    MeshCache m_meshCache;
     glm::ivec2 m_size = {1, 1};
+    int m_tileSize = 8;
+    TileSchedule m_tileSchedule;
+
+    // Row-major indices of the tiles in the schedule's order, for a grid of m_tileOrderGrid tiles.
+    std::vector<int> m_tileOrder;
+    glm::ivec2 m_tileOrderGrid = {0, 0};
+    tbb::affinity_partitioner m_affinityPartitioner;
+    int m_packetSize = 0;
 
     RTCDevice m_device;
-    RTCScene m_scene;
-    Object *m_mainObject = nullptr;
-    Object *m_roomObject = nullptr;
-    Object *m_mirrorObject = nullptr;
+
+    // Latest loaded world, only accessed through std::atomic_load/atomic_store.
+    // The world of the current frame holds a reference, so a replaced world is freed once no frame uses it.
+    std::shared_ptr<const World> m_world;
+    std::shared_ptr<const World> m_frameWorld;
+
+    // Each load gets a new generation. Builds of older generations stop at the next progress report.
+    std::atomic<int> m_loadGeneration{0};
+    std::atomic<int> m_finishedGeneration{0};
+    std::atomic<float> m_loadProgress{0.0f};
+    std::mutex m_publishMutex;
+
+    std::atomic<BuildProfile> m_buildProfile;
+    std::atomic<long long> m_deviceBytes{0};
+    std::atomic<long long> m_meshBytes{0};
+    std::atomic<bool> m_budgetExceeded{false};
+    std::atomic<bool> m_animating;
+    bool m_animatingLights;
+    long long m_memoryBudget;
+    PixelFormat m_pixelFormat;
+
+    std::atomic<bool> m_progressive;
+    bool m_frameProgressive = false;
+    int m_maxSamples;
+    float m_convergenceThreshold;
+
+    // Progressive mode: sum of each pixel's samples, and squared deviations of their luminance.
+    std::vector<glm::vec3> m_accumulation;
+    std::vector<float> m_deviations;
+
+    // Samples taken in each tile, and the estimated error of their average.
+    std::vector<int> m_tileSamples;
+    std::vector<float> m_tileErrors;
+
+    float m_sampleCount = 0.0f;
+    float m_convergence = 1.0f;
+    int m_activeTileCount = 0;
+
+    bool m_reprojecting;
+    bool m_frameReprojecting = false;
+    int m_reprojectionAge;
+
+    // Pixels of the last frame, and of this one. The last frame's camera maps positions to its pixels.
+    std::vector<HistoryPixel> m_history;
+    std::vector<HistoryPixel> m_nextHistory;
+    bool m_historyValid = false;
+    glm::vec3 m_historyPosition = {0.0f, 0.0f, 0.0f};
+    glm::mat3 m_historyTransform = glm::mat3(1.0f);
     glm::vec3 m_mainColor = {0.8f, 0.8f, 1.0f};
     glm::vec3 m_roomColor = {1.0f, 1.0f, 1.0f};
     glm::vec3 m_mirrorColor = {0.6f, 0.6f, 0.7f};
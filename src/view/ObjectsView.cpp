@@ -1,5 +1,7 @@
 #include <QBoxLayout>
 
+#include <algorithm>
+
 #include "ObjectsView.hpp"
 
 ObjectsView::ObjectsView(const QStringList &objectPaths, QWidget *parent)
@@ -15,6 +17,14 @@ ObjectsView::ObjectsView(const QStringList &objectPaths, QWidget *parent)
         m_modelButtons.push_back(button);
     }
 
+    for (auto profile : getBuildProfiles()) {
+        m_profileBox->addItem(QString::fromStdString(getBuildProfileName(profile)));
+    }
+
+    connect(m_profileBox, QOverload<int>::of(&QComboBox::activated), [this](int index) {
+        emit buildProfileRequested(getBuildProfiles().at(static_cast<size_t>(index)));
+    });
+
     auto layout = new QVBoxLayout();
 
     layout->setAlignment(Qt::AlignTop);
@@ -23,23 +33,40 @@ ObjectsView::ObjectsView(const QStringList &objectPaths, QWidget *parent)
         layout->addWidget(button);
     }
 
+    layout->addWidget(m_profileBox);
     layout->addWidget(m_statusLabel);
+    layout->addWidget(m_buildLabel);
 
     setLayout(layout);
 }
 
-void ObjectsView::enableButtons() {
-    for (auto button: m_modelButtons) {
-        button->setDisabled(false);
+void ObjectsView::updateLoadingLabel(bool isLoading, float progress) {
+    if (!isLoading) {
+        m_statusLabel->setText("");
+    } else if (progress <= 0.0f) {
+        m_statusLabel->setText("Loading...");
+    } else {
+        m_statusLabel->setText(QString("Building... %1%").arg(static_cast<int>(progress * 100.0f)));
     }
-
-    m_statusLabel->setText("");
 }
 
-void ObjectsView::disableButtons() {
-    for (auto button: m_modelButtons) {
-        button->setDisabled(true);
+void ObjectsView::updateBuildLabel(const BuildStats &stats) {
+    if (stats.seconds <= 0.0) {
+        m_buildLabel->setText("");
+        return;
     }
 
-    m_statusLabel->setText("Loading...");
+    m_buildLabel->setText(
+            QString("Build (%1): %2 s, %3 MB")
+                    .arg(QString::fromStdString(getBuildProfileName(stats.profile)))
+                    .arg(stats.seconds, 0, 'f', 3)
+                    .arg(static_cast<double>(stats.bytes) / (1024.0 * 1024.0), 0, 'f', 1)
+    );
+}
+
+void ObjectsView::setBuildProfile(BuildProfile profile) {
+    auto &profiles = getBuildProfiles();
+    auto index = std::find(profiles.begin(), profiles.end(), profile) - profiles.begin();
+
+    m_profileBox->setCurrentIndex(static_cast<int>(index));
 }
@@ -4,6 +4,9 @@
 #include <QStringList>
 #include <QPushButton>
 #include <QLabel>
+#include <QComboBox>
+
+#include "../base/BuildProfile.hpp"
 
 class ObjectsView : public QWidget {
 Q_OBJECT
@@ -11,13 +14,17 @@ Q_OBJECT
 public:
     explicit ObjectsView(const QStringList &objectPaths, QWidget *parent = nullptr);
 
-    void enableButtons();
-    void disableButtons();
+    void updateLoadingLabel(bool isLoading, float progress);
+    void updateBuildLabel(const BuildStats &stats);
+    void setBuildProfile(BuildProfile profile);
 
 signals:
     void requested(QString &path);
+    void buildProfileRequested(BuildProfile profile);
 
 private:
     QVector<QPushButton *> m_modelButtons;
     QLabel *m_statusLabel = new QLabel("");
+    QLabel *m_buildLabel = new QLabel("");
+    QComboBox *m_profileBox = new QComboBox();
 };
@@ -1,7 +1,47 @@
 #include <QOpenGLFunctions>
 
+#include <cstring>
+
 #include "PixelsView.hpp"
 
+// From GL 4.4. (ARB_buffer_storage)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+static const GLbitfield persistentMapFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+static QOpenGLTexture::TextureFormat getTextureFormat(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGBA16F:
+            return QOpenGLTexture::RGBA16F;
+        case PixelFormat::RGB10A2:
+            return QOpenGLTexture::RGB10A2;
+        case PixelFormat::RGBA8SRGB:
+            // Sampled as linear colors, like the float formats.
+            return QOpenGLTexture::SRGB8_Alpha8;
+        default:
+            return QOpenGLTexture::RGBA32F;
+    }
+}
+
+static GLenum getPixelType(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::RGBA16F:
+            return GL_HALF_FLOAT;
+        case PixelFormat::RGB10A2:
+            return GL_UNSIGNED_INT_2_10_10_10_REV;
+        case PixelFormat::RGBA8SRGB:
+            return GL_UNSIGNED_BYTE;
+        default:
+            return GL_FLOAT;
+    }
+}
+
 PixelsView::PixelsView(QWidget *parent) : QOpenGLWidget(parent) {
     auto format_ = format();
     format_.setRenderableType(QSurfaceFormat::OpenGL);
@@ -16,6 +56,7 @@ PixelsView::PixelsView(QWidget *parent) : QOpenGLWidget(parent) {
 
 PixelsView::~PixelsView() {
     makeCurrent();
+    releasePixelBuffers();
     delete m_program;
     delete m_vao;
     delete m_vbo;
@@ -32,12 +73,136 @@ const glm::ivec2 &PixelsView::getTextureSize() const {
     return m_textureSize;
 }
 
-void PixelsView::setPixels(const void *pixels) {
-    m_texture->setData(QOpenGLTexture::RGBA, QOpenGLTexture::Float32, pixels);
+void PixelsView::setTextureSize(const glm::ivec2 &size) {
+    if (m_textureSize == size) {
+        return;
+    }
+
+    m_textureSize = size;
+
+    // Otherwise, initializeGL() creates the texture.
+    if (isValid()) {
+        makeCurrent();
+        resetTexture();
+        doneCurrent();
+    }
+}
+
+void PixelsView::setPixelFormat(PixelFormat format) {
+    if (m_pixelFormat == format) {
+        return;
+    }
+
+    m_pixelFormat = format;
+
+    // Otherwise, initializeGL() creates the texture.
+    if (isValid()) {
+        makeCurrent();
+        resetTexture();
+        doneCurrent();
+    }
+}
+
+long long PixelsView::getUploadedFrame() const {
+    return m_uploadedFrame;
+}
+
+bool PixelsView::setPixels(const void *pixels, const std::vector<glm::ivec4> &rects, long long frame) {
+    // Not shown yet: the frame stays pending.
+    if (!isValid()) {
+        return false;
+    }
+
+    // A new texture has no pixels yet: fill all of it.
+    auto fullRects = std::vector<glm::ivec4>{{0, 0, m_textureSize.x, m_textureSize.y}};
+    auto &uploadRects = (m_uploadedFrame < 0) ? fullRects : rects;
+
+    // Nothing changed, so the texture already holds this frame.
+    if (uploadRects.empty()) {
+        m_uploadedFrame = frame;
+        return false;
+    }
+
+    makeCurrent();
+
+    auto gl = QOpenGLContext::currentContext()->extraFunctions();
+    auto size = getPixelBufferSize();
+    auto pixelSize = getPixelSize(m_pixelFormat);
+    auto rowSize = static_cast<size_t>(m_textureSize.x) * pixelSize;
+    auto &pixelBuffer = m_pixelBuffers[m_pixelBufferIndex];
+
+    m_pixelBufferIndex = (m_pixelBufferIndex + 1) % m_pixelBuffers.size();
+
+    // The GPU read this buffer frames ago, so this rarely waits.
+    if (pixelBuffer.fence != nullptr) {
+        gl->glClientWaitSync(pixelBuffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        gl->glDeleteSync(pixelBuffer.fence);
+        pixelBuffer.fence = nullptr;
+    }
+
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+
+    auto data = pixelBuffer.data;
+
+    if (data == nullptr) {
+        data = gl->glMapBufferRange(
+                GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+        );
+    }
+
+    // Each rectangle goes to the same place in the buffer, so the buffer is laid out like the texture.
+    for (auto &rect : uploadRects) {
+        auto offset = static_cast<size_t>(rect.y) * rowSize + static_cast<size_t>(rect.x) * pixelSize;
+        auto target = static_cast<unsigned char *>(data) + offset;
+        auto source = static_cast<const unsigned char *>(pixels) + offset;
+
+        if (rect.z == m_textureSize.x) {
+            std::memcpy(target, source, rowSize * rect.w);
+            continue;
+        }
+
+        for (int y = 0; y < rect.w; y++) {
+            std::memcpy(target + y * rowSize, source + y * rowSize, rect.z * pixelSize);
+        }
+    }
+
+    if (pixelBuffer.data == nullptr) {
+        gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // Reads from the bound buffer: returns without waiting for the copy.
+    m_texture->bind();
+    gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, m_textureSize.x);
+
+    for (auto &rect : uploadRects) {
+        auto offset = static_cast<size_t>(rect.y) * rowSize + static_cast<size_t>(rect.x) * pixelSize;
+
+        gl->glTexSubImage2D(
+                GL_TEXTURE_2D, 0, rect.x, rect.y, rect.z, rect.w, GL_RGBA,
+                getPixelType(m_pixelFormat), reinterpret_cast<const void *>(offset)
+        );
+    }
+
+    gl->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    pixelBuffer.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    m_uploadedFrame = frame;
+
+    doneCurrent();
+
+    return true;
 }
 
 void PixelsView::initializeGL() {
-    auto gl = QOpenGLContext::currentContext()->functions();
+    auto context = QOpenGLContext::currentContext();
+    auto gl = context->functions();
+
+    if (context->format().version() >= qMakePair(4, 4) || context->hasExtension("GL_ARB_buffer_storage")) {
+        m_bufferStorage = reinterpret_cast<BufferStorageFunction>(context->getProcAddress("glBufferStorage"));
+    }
 
     gl->glEnable(GL_DEPTH);
     gl->glDepthFunc(GL_LESS);
@@ -122,6 +287,10 @@ void main() {
         m_ibo->allocate(indices, static_cast<int>(sizeof(indices)));
     }
 
+    // A new context has none of the old buffers.
+    m_pixelBuffers.fill(PixelBuffer());
+    m_pixelBufferCapacity = 0;
+
     resetTexture();
 }
 
@@ -144,23 +313,8 @@ void PixelsView::paintGL() {
 }
 
 void PixelsView::resizeGL(int width, int height) {
+    // The texture keeps its size until frames of the new size come. (See setTextureSize())
     m_viewSize = {width, height};
-
-    /*
-    int sizeLimit = 800;
-
-    if (m_viewSize.x >= sizeLimit && m_viewSize.x >= m_viewSize.y) {
-        m_textureSize = {sizeLimit, m_viewSize.y * sizeLimit / m_viewSize.x};
-    } else if (m_viewSize.y >= sizeLimit && m_viewSize.y >= m_viewSize.x) {
-        m_textureSize = {m_viewSize.x * sizeLimit / m_viewSize.y, sizeLimit};
-    } else {
-        m_textureSize = m_viewSize;
-    }
-    */
-
-    m_textureSize = m_viewSize;
-
-    resetTexture();
 }
 
 QSize PixelsView::sizeHint() const {
@@ -174,7 +328,70 @@ void PixelsView::resetTexture() {
 
     m_texture->create();
     m_texture->setSize(m_textureSize.x, m_textureSize.y);
-    m_texture->setFormat(QOpenGLTexture::RGBA32F);
+    m_texture->setFormat(getTextureFormat(m_pixelFormat));
     m_texture->allocateStorage();
+    m_texture->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
+    m_texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+    m_uploadedFrame = -1;
+
+    if (getPixelBufferSize() > m_pixelBufferCapacity) {
+        resetPixelBuffers();
+    }
+}
+
+void PixelsView::resetPixelBuffers() {
+    auto gl = QOpenGLContext::currentContext()->extraFunctions();
+    auto size = static_cast<GLsizeiptr>(getPixelBufferSize());
+
+    releasePixelBuffers();
+    m_pixelBufferCapacity = static_cast<size_t>(size);
+
+    for (auto &pixelBuffer : m_pixelBuffers) {
+        gl->glGenBuffers(1, &pixelBuffer.buffer);
+        gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+
+        if (m_bufferStorage != nullptr) {
+            m_bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, persistentMapFlags);
+            pixelBuffer.data = gl->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, persistentMapFlags);
+        } else {
+            gl->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+    }
+
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_pixelBufferIndex = 0;
+}
+
+void PixelsView::releasePixelBuffers() {
+    auto context = QOpenGLContext::currentContext();
+
+    if (context == nullptr) {
+        return;
+    }
+
+    auto gl = context->extraFunctions();
+
+    for (auto &pixelBuffer : m_pixelBuffers) {
+        if (pixelBuffer.fence != nullptr) {
+            gl->glDeleteSync(pixelBuffer.fence);
+        }
+
+        if (pixelBuffer.data != nullptr) {
+            gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+            gl->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+
+        if (pixelBuffer.buffer != 0) {
+            gl->glDeleteBuffers(1, &pixelBuffer.buffer);
+        }
+
+        pixelBuffer = PixelBuffer();
+    }
+
+    gl->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+size_t PixelsView::getPixelBufferSize() const {
+    return static_cast<size_t>(m_textureSize.x) * static_cast<size_t>(m_textureSize.y) * getPixelSize(m_pixelFormat);
 }
 
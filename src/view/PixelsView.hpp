@@ -5,10 +5,15 @@
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
 #include <QOpenGLTexture>
+#include <QOpenGLExtraFunctions>
 #include <QVector>
 
 #include <glm/glm.hpp>
 
+#include <vector>
+
+#include "../base/PixelFormat.hpp"
+
 class PixelsView : public QOpenGLWidget {
 Q_OBJECT
 
@@ -19,15 +24,37 @@ public:
     const glm::ivec2 &getViewSize() const;
     const glm::ivec2 &getTextureSize() const;
 
-    void setPixels(const void *pixels);
+    // The texture is stretched over the view, so frames can be rendered at a lower resolution.
+    void setTextureSize(const glm::ivec2 &size);
+
+    // Last frame whose pixels the texture holds, or -1 if none. (e.g. The texture was just reset)
+    long long getUploadedFrame() const;
+
+    // Pixels of the given frame, of the texture size, in the format set below.
+    // Only the rectangles (x, y, width, height) are uploaded, unless the texture holds no frame.
+    // Returns whether anything was uploaded, i.e. the view needs a repaint.
+    bool setPixels(const void *pixels, const std::vector<glm::ivec4> &rects, long long frame);
+    void setPixelFormat(PixelFormat format);
 
 private:
+    // Pixel unpack buffer the frames are uploaded through.
+    struct PixelBuffer {
+        GLuint buffer = 0;
+        void *data = nullptr;
+        GLsync fence = nullptr;
+    };
+
+    typedef void (QOPENGLF_APIENTRYP BufferStorageFunction)(GLenum, GLsizeiptr, const void *, GLbitfield);
+
     void initializeGL() override;
     void paintGL() override;
     void resizeGL(int width, int height) override;
     QSize sizeHint() const override;
 
     void resetTexture();
+    void resetPixelBuffers();
+    void releasePixelBuffers();
+    size_t getPixelBufferSize() const;
 
     QOpenGLShaderProgram *m_program = new QOpenGLShaderProgram();
     QOpenGLVertexArrayObject *m_vao = new QOpenGLVertexArrayObject();
@@ -35,6 +62,16 @@ private:
     QOpenGLBuffer *m_ibo = new QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
     QOpenGLTexture *m_texture = new QOpenGLTexture(QOpenGLTexture::Target2D);
 
+    // A ring of buffers, so a frame is written while the GPU still reads the previous ones.
+    // Persistently mapped when glBufferStorage is available, mapped for each frame otherwise.
+    QVector<PixelBuffer> m_pixelBuffers = QVector<PixelBuffer>(3);
+    int m_pixelBufferIndex = 0;
+    // Bytes each buffer holds. The ring is only reallocated when a frame needs more.
+    size_t m_pixelBufferCapacity = 0;
+    BufferStorageFunction m_bufferStorage = nullptr;
+    PixelFormat m_pixelFormat = PixelFormat::RGBA32F;
+    long long m_uploadedFrame = -1;
+
     glm::ivec2 m_viewSize = {1, 1};
     glm::ivec2 m_textureSize = {1, 1};
 };
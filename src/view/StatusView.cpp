@@ -1,20 +1,58 @@
 #include <QBoxLayout>
 
+#include <algorithm>
+
 #include "StatusView.hpp"
 
 StatusView::StatusView(QWidget *parent) : QWidget(parent) {
     updateSizeLabel({0, 0});
+    updateResolutionLabel({0, 0}, 1.0f);
     updateFrameLabel();
     updateFPSLabel(0);
+    updateFrameTimeLabel(0, 0, 0);
     updateRPSLabel(0);
+    updateRayStatsLabel(RayStats());
+    updateHeadroomLabel(0);
+    updateMemoryLabel(0, 0);
+    updateSamplesLabel(0, 0);
+    updateErrorLabel("");
+
+    m_errorLabel->setWordWrap(true);
+    m_errorLabel->setStyleSheet("color: red");
+
+    for (auto policy : FrameGovernor::getPolicies()) {
+        m_governorBox->addItem(QString::fromStdString(FrameGovernor::getPolicyName(policy)));
+    }
+
+    connect(m_governorBox, QOverload<int>::of(&QComboBox::activated), [this](int index) {
+        emit governorRequested(FrameGovernor::getPolicies().at(static_cast<size_t>(index)));
+    });
+
+    connect(m_animateBox, &QCheckBox::toggled, [this](bool checked) {
+        emit animateRequested(checked);
+    });
+
+    connect(m_progressiveBox, &QCheckBox::toggled, [this](bool checked) {
+        emit progressiveRequested(checked);
+    });
 
     auto layout = new QVBoxLayout();
 
     layout->setAlignment(Qt::AlignTop);
     //layout->addWidget(m_sizeLabel);
     //layout->addWidget(m_frameLabel);
+    layout->addWidget(m_resolutionLabel);
     layout->addWidget(m_fpsLabel);
+    layout->addWidget(m_frameTimeLabel);
     layout->addWidget(m_rpsLabel);
+    layout->addWidget(m_rayStatsLabel);
+    layout->addWidget(m_headroomLabel);
+    layout->addWidget(m_memoryLabel);
+    layout->addWidget(m_samplesLabel);
+    layout->addWidget(m_errorLabel);
+    layout->addWidget(m_governorBox);
+    layout->addWidget(m_animateBox);
+    layout->addWidget(m_progressiveBox);
 
     setLayout(layout);
 }
@@ -23,6 +61,10 @@ void StatusView::updateSizeLabel(const glm::ivec2 &size) {
     m_sizeLabel->setText(QString("Size: %1 X %2").arg(size.x, 4).arg(size.y, 4));
 }
 
+void StatusView::updateResolutionLabel(const glm::ivec2 &size, float scale) {
+    m_resolutionLabel->setText(QString("Resolution: %1 X %2 (%3%)").arg(size.x).arg(size.y).arg(scale * 100.0f, 0, 'f', 0));
+}
+
 void StatusView::updateFrameLabel() {
     static int index = 0;
     QString symbols = "--\\\\||//";
@@ -35,6 +77,82 @@ void StatusView::updateFPSLabel(float fps) {
     m_fpsLabel->setText(QString("FPS: %1").arg(fps, 7, 'f', 3, '0'));
 }
 
+void StatusView::updateFrameTimeLabel(float median, float p95, float p99) {
+    m_frameTimeLabel->setText(
+            QString("Frame: %1 / %2 / %3 ms\n(p50 / p95 / p99)")
+                    .arg(median, 0, 'f', 1)
+                    .arg(p95, 0, 'f', 1)
+                    .arg(p99, 0, 'f', 1)
+    );
+}
+
 void StatusView::updateRPSLabel(float rps) {
     m_rpsLabel->setText(QString("%1 Mrays/s").arg(rps / 1000000.0f, 7, 'f', 3, '0'));
 }
+
+void StatusView::updateRayStatsLabel(const RayStats &stats) {
+    auto toMillions = [](long long count) {
+        return static_cast<double>(count) / 1000000.0;
+    };
+
+    auto intersections = stats.hits + stats.misses;
+    auto hitRate = (intersections > 0) ? static_cast<double>(stats.hits) / static_cast<double>(intersections) : 0.0;
+
+    auto reuseRate = (stats.primaryRays > 0)
+                     ? static_cast<double>(stats.reprojectedPixels) / static_cast<double>(stats.primaryRays)
+                     : 0.0;
+
+    m_rayStatsLabel->setText(
+            QString("Primary: %1 M\nShadow: %2 M\nReflection: %3 M\nHits: %4%\nReprojected: %5%")
+                    .arg(toMillions(stats.primaryRays), 7, 'f', 3, '0')
+                    .arg(toMillions(stats.shadowRays), 7, 'f', 3, '0')
+                    .arg(toMillions(stats.reflectionRays), 7, 'f', 3, '0')
+                    .arg(hitRate * 100.0, 5, 'f', 1, '0')
+                    .arg(reuseRate * 100.0, 5, 'f', 1, '0')
+    );
+}
+
+void StatusView::updateHeadroomLabel(float headroom) {
+    m_headroomLabel->setText(QString("Headroom: %1%").arg(headroom * 100.0f, 5, 'f', 1, '0'));
+}
+
+void StatusView::updateMemoryLabel(long long bytes, long long budget) {
+    auto toMegabytes = [](long long count) {
+        return static_cast<double>(count) / (1024.0 * 1024.0);
+    };
+
+    if (budget > 0) {
+        m_memoryLabel->setText(
+                QString("Memory: %1 / %2 MB").arg(toMegabytes(bytes), 0, 'f', 1).arg(toMegabytes(budget), 0, 'f', 1)
+        );
+    } else {
+        m_memoryLabel->setText(QString("Memory: %1 MB").arg(toMegabytes(bytes), 0, 'f', 1));
+    }
+}
+
+// Convergence: estimated error of the noisiest tile.
+void StatusView::updateSamplesLabel(float sampleCount, float convergence) {
+    m_samplesLabel->setText(
+            QString("Samples: %1 / px (Error: %2)").arg(sampleCount, 0, 'f', 1).arg(convergence, 0, 'f', 4)
+    );
+}
+
+void StatusView::updateErrorLabel(const QString &message) {
+    m_errorLabel->setText(QString("Error: %1").arg(message));
+    m_errorLabel->setVisible(!message.isEmpty());
+}
+
+void StatusView::setGovernorPolicy(FrameGovernor::Policy policy) {
+    auto &policies = FrameGovernor::getPolicies();
+    auto index = std::find(policies.begin(), policies.end(), policy) - policies.begin();
+
+    m_governorBox->setCurrentIndex(static_cast<int>(index));
+}
+
+void StatusView::setAnimating(bool animating) {
+    m_animateBox->setChecked(animating);
+}
+
+void StatusView::setProgressive(bool progressive) {
+    m_progressiveBox->setChecked(progressive);
+}
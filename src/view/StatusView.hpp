@@ -1,9 +1,14 @@
 #pragma once
 
 #include <QLabel>
+#include <QComboBox>
+#include <QCheckBox>
 
 #include <glm/glm.hpp>
 
+#include "../base/FrameGovernor.hpp"
+#include "../base/RayStats.hpp"
+
 class StatusView : public QWidget {
 Q_OBJECT
 
@@ -11,13 +16,39 @@ public:
     explicit StatusView(QWidget *parent = nullptr);
 
     void updateSizeLabel(const glm::ivec2 &size);
+    void updateResolutionLabel(const glm::ivec2 &size, float scale);
     void updateFrameLabel();
     void updateFPSLabel(float fps);
+    void updateFrameTimeLabel(float median, float p95, float p99);
     void updateRPSLabel(float rps);
+    void updateRayStatsLabel(const RayStats &stats);
+    void updateHeadroomLabel(float headroom);
+    void updateMemoryLabel(long long bytes, long long budget);
+    void updateSamplesLabel(float sampleCount, float convergence);
+    // Hidden while the message is empty.
+    void updateErrorLabel(const QString &message);
+    void setGovernorPolicy(FrameGovernor::Policy policy);
+    void setAnimating(bool animating);
+    void setProgressive(bool progressive);
+
+signals:
+    void governorRequested(FrameGovernor::Policy policy);
+    void animateRequested(bool animating);
+    void progressiveRequested(bool progressive);
 
 private:
     QLabel *m_sizeLabel = new QLabel();
+    QLabel *m_resolutionLabel = new QLabel();
     QLabel *m_frameLabel = new QLabel();
     QLabel *m_fpsLabel = new QLabel();
+    QLabel *m_frameTimeLabel = new QLabel();
     QLabel *m_rpsLabel = new QLabel();
+    QLabel *m_rayStatsLabel = new QLabel();
+    QLabel *m_headroomLabel = new QLabel();
+    QLabel *m_memoryLabel = new QLabel();
+    QLabel *m_samplesLabel = new QLabel();
+    QLabel *m_errorLabel = new QLabel();
+    QComboBox *m_governorBox = new QComboBox();
+    QCheckBox *m_animateBox = new QCheckBox("Animate");
+    QCheckBox *m_progressiveBox = new QCheckBox("Progressive");
 };
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal checks for the test executables: failures are printed, and main() returns their count.
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cout << __FILE__ << ":" << __LINE__ << ": Check failed: " << #condition << "\n"; \
+            checkFailures++; \
+        } \
+    } while (false)
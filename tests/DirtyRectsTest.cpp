@@ -0,0 +1,84 @@
+#include <vector>
+
+#include "base/DirtyRects.hpp"
+#include "Check.hpp"
+
+typedef std::vector<glm::ivec4> Rects;
+
+// Tiles of the grid changed in frame 1 where the mask has a '#', and in frame 0 elsewhere.
+static std::vector<long long> createTileFrames(const std::vector<const char *> &mask) {
+    std::vector<long long> tileFrames;
+
+    for (auto row : mask) {
+        for (auto tile = row; *tile != '\0'; tile++) {
+            tileFrames.push_back((*tile == '#') ? 1 : 0);
+        }
+    }
+
+    return tileFrames;
+}
+
+static int countPixels(const Rects &rects) {
+    int count = 0;
+
+    for (auto &rect : rects) {
+        count += rect.z * rect.w;
+    }
+
+    return count;
+}
+
+static void testUnchanged() {
+    auto tileFrames = createTileFrames({"....", "...."});
+
+    CHECK(getDirtyRects({32, 16}, 8, tileFrames, 0).empty());
+    CHECK(getDirtyRects({32, 16}, 8, tileFrames, 1).empty());
+}
+
+static void testSingleTile() {
+    auto tileFrames = createTileFrames({"....", "..#.", "...."});
+
+    CHECK(getDirtyRects({32, 24}, 8, tileFrames, 0) == Rects({{16, 8, 8, 8}}));
+}
+
+static void testFullRow() {
+    auto tileFrames = createTileFrames({"....", "####", "...."});
+
+    CHECK(getDirtyRects({32, 24}, 8, tileFrames, 0) == Rects({{0, 8, 32, 8}}));
+}
+
+static void testRaggedEdges() {
+    // 30 x 20 pixels: the last column of tiles is 6 pixels wide, and the last row 4 pixels high.
+    auto tileFrames = createTileFrames({"...#", "....", "..##"});
+
+    CHECK(getDirtyRects({30, 20}, 8, tileFrames, 0) == Rects({{24, 0, 6, 8}, {16, 16, 14, 4}}));
+}
+
+static void testLShape() {
+    // The vertical bar merges down the rows, and the foot becomes its own, wider rectangle.
+    auto tileFrames = createTileFrames({"#...", "#...", "###."});
+    auto rects = getDirtyRects({32, 24}, 8, tileFrames, 0);
+
+    CHECK(rects == Rects({{0, 0, 8, 16}, {0, 16, 24, 8}}));
+    CHECK(countPixels(rects) == 5 * 8 * 8);
+}
+
+static void testUnknownLayout() {
+    auto full = Rects({{0, 0, 30, 20}});
+
+    // Too few tiles for the size, and no tile size.
+    CHECK(getDirtyRects({30, 20}, 8, createTileFrames({"....", "...."}), 0) == full);
+    CHECK(getDirtyRects({30, 20}, 8, {}, 0) == full);
+    CHECK(getDirtyRects({30, 20}, 0, createTileFrames({"....", "....", "...."}), 0) == full);
+}
+
+int main() {
+    testUnchanged();
+    testSingleTile();
+    testFullRow();
+    testRaggedEdges();
+    testLShape();
+    testUnknownLayout();
+
+    return checkFailures;
+}
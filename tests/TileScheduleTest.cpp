@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <vector>
+
+#include "base/TileSchedule.hpp"
+#include "Check.hpp"
+
+// Whether the order holds every tile of the grid exactly once.
+static bool isPermutation(std::vector<int> order, int numTilesX, int numTilesY) {
+    std::sort(order.begin(), order.end());
+
+    for (size_t i = 0; i < order.size(); i++) {
+        if (order[i] != static_cast<int>(i)) {
+            return false;
+        }
+    }
+
+    return order.size() == static_cast<size_t>(numTilesX * numTilesY);
+}
+
+static int countTiles(const glm::ivec2 &size, int tileSize) {
+    return ((size.x + tileSize - 1) / tileSize) * ((size.y + tileSize - 1) / tileSize);
+}
+
+static void testTileOrders() {
+    // Square, non-square and non-power of 2 grids, down to a single tile.
+    std::vector<glm::ivec2> grids = {{1, 1}, {1, 7}, {7, 1}, {4, 4}, {8, 3}, {5, 13}, {17, 9}, {240, 135}};
+
+    for (auto order : getTileOrders()) {
+        for (auto &grid : grids) {
+            CHECK(isPermutation(createTileOrder(order, grid.x, grid.y), grid.x, grid.y));
+        }
+    }
+
+    CHECK(createTileOrder(TileOrder::RowMajor, 3, 2) == std::vector<int>({0, 1, 2, 3, 4, 5}));
+    CHECK(createTileOrder(TileOrder::Morton, 2, 2) == std::vector<int>({0, 1, 2, 3}));
+    CHECK(createTileOrder(TileOrder::Hilbert, 2, 2) == std::vector<int>({0, 2, 3, 1}));
+}
+
+static void testHilbertSteps() {
+    // Consecutive tiles of a full Hilbert curve are neighbors.
+    auto order = createTileOrder(TileOrder::Hilbert, 16, 16);
+
+    for (size_t i = 1; i < order.size(); i++) {
+        int dx = order[i] % 16 - order[i - 1] % 16;
+        int dy = order[i] / 16 - order[i - 1] / 16;
+
+        CHECK(dx * dx + dy * dy == 1);
+    }
+}
+
+static void testChooseTileSize() {
+    std::vector<glm::ivec2> sizes = {{1, 1}, {100, 100}, {600, 500}, {1920, 1080}, {3840, 2160}, {1000, 7}};
+
+    for (auto &size : sizes) {
+        for (auto threadCount : {1, 2, 8, 64}) {
+            auto tileSize = chooseTileSize(size, threadCount);
+
+            CHECK(tileSize >= 4 && tileSize % 4 == 0);
+
+            // Only the smallest tiles may give fewer tiles per thread, when nothing else is left.
+            CHECK(countTiles(size, tileSize) >= 64 * threadCount || tileSize == 4);
+
+            // The largest size doing so.
+            CHECK(tileSize == 32 || countTiles(size, tileSize * 2) < 64 * threadCount);
+        }
+    }
+}
+
+int main() {
+    testTileOrders();
+    testHilbertSteps();
+    testChooseTileSize();
+
+    return checkFailures;
+}